@@ -23,6 +23,8 @@
 #include "genie/file/ISerializable.h"
 #include "Unit.h"
 
+#include <memory>
+
 namespace genie {
 
 /// Class holding information about a civilization
@@ -62,12 +64,46 @@ public:
 
     std::vector<int32_t> UnitPointers;
 
-    /// Units defined for this civ.
+    /// Units defined for this civ. Empty while the units are shared.
     std::vector<Unit> Units;
 
     std::vector<int16_t> UniqueUnitsTechs = { -1, -1, -1, -1 }; // Unknown in >=SWGB (cnt=4)
 
+    //----------------------------------------------------------------------------
+    /// Moves Units into pool, keeping references to the pooled units. Units
+    /// equal to ones of other civs using the same pool are kept in memory
+    /// once.
+    //
+    void shareUnits(UnitPool &pool);
+
+    //----------------------------------------------------------------------------
+    /// Copies the shared units back into Units.
+    //
+    void unshareUnits(void);
+
+    //----------------------------------------------------------------------------
+    bool hasSharedUnits(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Number of units, shared or not.
+    //
+    size_t getUnitCount(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Unit for reading, shared or not.
+    //
+    const Unit &getUnit(size_t id) const;
+
+    //----------------------------------------------------------------------------
+    /// Unit for modifying. A shared unit is copied first, so the change
+    /// doesn't show up in other civs.
+    //
+    Unit &editUnit(size_t id);
+
 private:
+    /// Used instead of Units while the units are shared.
+    std::vector<std::shared_ptr<Unit>> sharedUnits_;
+
     virtual void serializeObject(void);
 };
 }
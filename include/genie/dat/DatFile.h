@@ -23,6 +23,8 @@
 
 #include <string>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "genie/Types.h"
 #include "genie/file/IFile.h"
@@ -58,12 +60,25 @@ public:
     virtual ~DatFile();
 
     //----------------------------------------------------------------------------
+    /// Loads the sections a lazily loaded file hasn't loaded yet before the
+    /// version changes.
+    //
     virtual void setGameVersion(GameVersion gv);
 
+    //----------------------------------------------------------------------------
+    /// Overrides the number of terrains expected when loading this file, for
+    /// dat files with more terrains than the game version uses by default.
+    ///
+    /// @param cnt number of terrains, 0 to use the default
+    //
+    void setTerrainCount(unsigned short cnt);
+
     //----------------------------------------------------------------------------
     /// Uncompress dat file.
+    ///
+    /// @return number of uncompressed bytes written
     //
-    void extractRaw(const char *inFile, const char *outFile);
+    size_t extractRaw(const char *inFile, const char *outFile);
 
     //----------------------------------------------------------------------------
     /// Debug information will be printed to stdout if activated.
@@ -72,6 +87,153 @@ public:
     //
     void setVerboseMode(bool verbose);
 
+    //----------------------------------------------------------------------------
+    /// Parts of the file that can be loaded on their own in lazy mode. Scalar
+    /// members stored between two lists belong to the section before them.
+    /// Everything up to and including the terrain restrictions is always
+    /// loaded.
+    //
+    enum Section {
+        SECTION_PLAYER_COLOURS = 0,
+        SECTION_SOUNDS,
+        SECTION_GRAPHICS,
+        SECTION_TERRAIN_BLOCK,
+        SECTION_RANDOM_MAPS,
+        SECTION_EFFECTS,
+        SECTION_UNIT_LINES,
+        SECTION_UNIT_HEADERS,
+        SECTION_CIVS,
+        SECTION_TECHS,
+        SECTION_TECH_TREE,
+        SECTION_COUNT
+    };
+
+    //----------------------------------------------------------------------------
+    /// In lazy mode load() only decompresses the file and reads the header.
+    /// Sections are read when requested with loadSection(). Sections that
+    /// were never loaded are saved unchanged.
+    ///
+    /// @param lazy true to activate
+    //
+    void setLazyLoading(bool lazy);
+
+    //----------------------------------------------------------------------------
+    bool isLazyLoading(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Units equal in several civs are kept in memory once when loading, see
+    /// Civ::shareUnits(). Use Civ::getUnit() and Civ::editUnit() to access
+    /// them, or Civ::unshareUnits() to get Civ::Units back. Saving writes
+    /// every civ in full as usual.
+    ///
+    /// @param share true to activate
+    //
+    void setUnitSharing(bool share);
+
+    //----------------------------------------------------------------------------
+    bool isUnitSharing(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Sets how the compressed file is inflated while loading.
+    //
+    void setDecompressionMode(Compressor::DecompressionMode mode);
+
+    //----------------------------------------------------------------------------
+    /// Sets the library used for in-memory (de)compression.
+    ///
+    /// @return false if the backend isn't compiled in
+    //
+    bool setCompressionBackend(CompressionBackend::Type type);
+
+    //----------------------------------------------------------------------------
+    /// Sets how strongly the file is compressed when saving, see
+    /// Compressor::CompressionProfile.
+    //
+    void setCompressionProfile(Compressor::CompressionProfile profile);
+
+    //----------------------------------------------------------------------------
+    /// Reads a section of a lazily loaded file into its members, if it isn't
+    /// already. Sections before it, that weren't loaded yet, are read once to
+    /// find its position but not kept.
+    ///
+    /// @param section section to load
+    //
+    void loadSection(Section section);
+
+    //----------------------------------------------------------------------------
+    /// Loads every section that isn't loaded yet.
+    //
+    void loadAllSections(void);
+
+    //----------------------------------------------------------------------------
+    /// Number of threads reading sections, and civs one by one, at the same
+    /// time when all sections are loaded. This needs to know where each of
+    /// them starts, which is the case when loading from a snapshot file, see
+    /// setSnapshotFile(). Otherwise sections are read one after the other,
+    /// and the positions written to the snapshot.
+    ///
+    /// @param threads 1 (the default) to read sequentially, 0 to use one
+    ///                thread per core
+    //
+    void setLoadThreads(unsigned threads);
+
+    //----------------------------------------------------------------------------
+    unsigned getLoadThreads(void) const;
+
+    //----------------------------------------------------------------------------
+    /// @return true if the members of the section hold the file data, always
+    ///         the case if the file wasn't loaded lazily
+    //
+    bool isSectionLoaded(Section section) const;
+
+    //----------------------------------------------------------------------------
+    /// With incremental saving the uncompressed file data is kept after
+    /// loading and saving. Unchanged sections are saved by copying their
+    /// kept data instead of serializing them again. Needs to be set before
+    /// loading.
+    ///
+    /// Sections are hashed when loaded and before saving to find changes.
+    /// Sections marked with markDirty() are serialized without hashing.
+    ///
+    /// @param incremental true to activate
+    //
+    void setIncrementalSaving(bool incremental);
+
+    //----------------------------------------------------------------------------
+    bool isIncrementalSaving(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Marks a loaded section as changed, so it is serialized on the next
+    /// save without checking its hash. The header is always serialized.
+    /// Changing the game version marks all sections.
+    //
+    void markDirty(Section section);
+
+    //----------------------------------------------------------------------------
+    /// @return true if the section is marked to be serialized on the next
+    ///         save, changes found by hashing are only marked when saving
+    //
+    bool isSectionDirty(Section section) const;
+
+    //----------------------------------------------------------------------------
+    /// Sets a snapshot file to speed up loading the same dat file again. It
+    /// holds the uncompressed file data and where the sections start, for a
+    /// hash of the compressed file and the game version.
+    ///
+    /// If the snapshot matches, load() maps it into memory instead of
+    /// inflating the file, and in lazy mode sections are read without
+    /// finding them first. Otherwise the file is loaded as usual and the
+    /// snapshot written for the next time.
+    ///
+    /// @param fileName snapshot file, empty to use none
+    //
+    void setSnapshotFile(const std::string &fileName);
+
+    //----------------------------------------------------------------------------
+    /// @return true if the last load() read the snapshot file
+    //
+    bool isLoadedFromSnapshot(void) const;
+
     // File data
     static const unsigned short FILE_VERSION_SIZE = 8;
     std::string FileVersion;
@@ -124,6 +286,10 @@ public:
     int8_t SUnknown8;
 
 private:
+    /// Need the serialization context to read and write single objects.
+    friend class DatPatch;
+    friend class DatFingerprint;
+
     // if true print debug messages
     bool verbose_ = false;
 
@@ -132,6 +298,40 @@ private:
 
     Compressor compressor_;
 
+    bool lazyLoading_ = false;
+    bool unitSharing_ = false;
+
+    /// Set with setTerrainCount(), also kept in the context for reading.
+    unsigned short terrainCount_ = 0;
+    bool incrementalSaving_ = false;
+
+    std::string snapshotFile_;
+    bool loadedFromSnapshot_ = false;
+
+    unsigned loadThreads_ = 1;
+
+    /// Uncompressed file data of a lazily loaded file.
+    std::unique_ptr<MemoryIStream> rawBody_;
+
+    static constexpr size_t NO_OFFSET = size_t(-1);
+
+    /// Start of each section in rawBody_ and the end of the last one,
+    /// NO_OFFSET where unknown yet.
+    std::vector<size_t> sectionOffsets_;
+    std::vector<bool> sectionLoaded_;
+    std::vector<bool> sectionDirty_;
+
+    /// Hash of each loaded section when it last matched rawBody_, to find
+    /// changes that weren't marked dirty.
+    std::vector<uint64_t> sectionHashes_;
+
+    /// Civ count of the SWGB header, kept for writing while civs aren't loaded.
+    uint16_t civCount_ = 0;
+
+    /// Start of each civ in rawBody_ and the end of the last one, empty if
+    /// unknown.
+    std::vector<size_t> civOffsets_;
+
     DatFile(const DatFile &other);
     DatFile &operator=(const DatFile &other);
 
@@ -141,6 +341,96 @@ private:
     virtual void unload(void);
 
     virtual void serializeObject(void);
+
+    //----------------------------------------------------------------------------
+    /// Decompresses the whole file into rawBody_ and reads the header.
+    //
+    void readRawBody(void);
+
+    //----------------------------------------------------------------------------
+    /// @return true if the section is written by copying it from rawBody_,
+    ///         because it isn't loaded or isn't dirty
+    //
+    bool isSectionRaw(Section section) const;
+
+    //----------------------------------------------------------------------------
+    /// Hash of a loaded section, including the members of DatFile stored in
+    /// it.
+    //
+    uint64_t hashSection(Section section);
+
+    //----------------------------------------------------------------------------
+    /// Marks loaded sections dirty whose hash changed since loading or the
+    /// last save.
+    //
+    void markChangedSections(void);
+
+    //----------------------------------------------------------------------------
+    /// Writes a raw section and all raw ones following it as they were read.
+    ///
+    /// @param offsets gets the start of the written sections relative to
+    ///                body, if not 0
+    /// @param body position of the written body start
+    /// @return last section written
+    //
+    int serializeRawSections(Section section, std::vector<size_t> *offsets = 0,
+                             size_t body = 0);
+
+    //----------------------------------------------------------------------------
+    /// Keeps the written data in out as rawBody_ for the next incremental
+    /// save.
+    ///
+    /// @param body start of the body in out
+    /// @param offsets section starts relative to body
+    //
+    void keepRawBody(const MemoryWriteBuffer *out, size_t body,
+                     std::vector<size_t> &offsets);
+
+    //----------------------------------------------------------------------------
+    /// Drops rawBody_ and everything known about its sections.
+    //
+    void releaseRawBody(void);
+
+    //----------------------------------------------------------------------------
+    /// Loads from the snapshot file if it matches the file, else from the
+    /// file and writes the snapshot.
+    //
+    void readWithSnapshot(void);
+
+    //----------------------------------------------------------------------------
+    /// @return false if the snapshot file doesn't exist or doesn't match
+    //
+    bool readSnapshot(uint64_t sourceHash, uint64_t sourceSize, GameVersion gv);
+
+    //----------------------------------------------------------------------------
+    /// Writes rawBody_ and the known section offsets to the snapshot file.
+    //
+    void writeSnapshot(uint64_t sourceHash, uint64_t sourceSize, GameVersion gv);
+
+    //----------------------------------------------------------------------------
+    /// Reads the civs, sharing their units if requested and noting where they
+    /// start when reading from rawBody_.
+    //
+    void readCivs(uint16_t count);
+
+    //----------------------------------------------------------------------------
+    /// @return true if the start and end of every section are known
+    //
+    bool canLoadInParallel(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Loads all sections with loadThreads_ threads.
+    //
+    void loadSectionsInParallel(void);
+
+    //----------------------------------------------------------------------------
+    /// Moves the members of a section read by another object here.
+    //
+    void takeSection(DatFile &from, Section section);
+
+    void serializeHeader(void);
+    void serializeSection(Section section);
+    void clearSection(Section section);
 };
 }
 
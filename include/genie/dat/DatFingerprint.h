@@ -0,0 +1,134 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GENIE_DATFINGERPRINT_H
+#define GENIE_DATFINGERPRINT_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "DatFile.h"
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Content hashes of every object of a dat file, rolled up into hashes of
+/// the civs, the sections and the whole file.
+///
+/// An object is hashed over what it serializes for the game version of the
+/// file, so padding and members the version doesn't store don't matter.
+/// Hashes are stable across runs and machines of the same byte order. After
+/// changing an object, update() functions rehash only it and the roll-ups
+/// above it.
+//
+class DatFingerprint
+{
+public:
+    DatFingerprint();
+    virtual ~DatFingerprint();
+
+    //----------------------------------------------------------------------------
+    /// Hashes all objects of file. Sections not loaded yet are loaded.
+    //
+    void build(DatFile &file);
+
+    //----------------------------------------------------------------------------
+    /// @return hash of the header and all sections
+    //
+    uint64_t getFileHash(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Hash of the version string, the members of DatFile that don't belong
+    /// to a list and the terrain restrictions.
+    //
+    uint64_t getHeaderHash(void) const;
+
+    //----------------------------------------------------------------------------
+    uint64_t getSectionHash(DatFile::Section section) const;
+
+    //----------------------------------------------------------------------------
+    /// Hashes of the elements of a section, one for the terrain block,
+    /// random maps and tech tree. Civ hashes include their units. Elements
+    /// that aren't stored in the file (pointer 0) have hash 0.
+    //
+    const std::vector<uint64_t> &getObjectHashes(DatFile::Section section) const;
+
+    //----------------------------------------------------------------------------
+    const std::vector<uint64_t> &getUnitHashes(size_t civ) const;
+
+    //----------------------------------------------------------------------------
+    /// Hash of the members of a civ without its units.
+    //
+    uint64_t getCivFieldsHash(size_t civ) const;
+
+    //----------------------------------------------------------------------------
+    /// Hash of the members of DatFile that don't belong to a list.
+    //
+    uint64_t getFileFieldsHash(void) const;
+
+    //----------------------------------------------------------------------------
+    const std::vector<uint64_t> &getTerrainRestrictionHashes(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Rehashes the header after its members or terrain restrictions
+    /// changed.
+    //
+    void updateHeader(DatFile &file);
+
+    //----------------------------------------------------------------------------
+    /// Rehashes all of a section, needed after elements were added or
+    /// removed. Also works without build() to hash single sections, the file
+    /// hash is meaningless then.
+    //
+    void updateSection(DatFile &file, DatFile::Section section);
+
+    //----------------------------------------------------------------------------
+    /// Rehashes one element of a section, for civs including their units.
+    //
+    void updateObject(DatFile &file, DatFile::Section section, size_t index);
+
+    //----------------------------------------------------------------------------
+    /// Rehashes one unit of a civ.
+    //
+    void updateUnit(DatFile &file, size_t civ, size_t unit);
+
+private:
+    static SerializationContext fileContext(DatFile &file);
+
+    uint64_t fileHash_ = 0;
+    uint64_t headerHash_ = 0;
+    uint64_t fileFieldsHash_ = 0;
+    std::vector<uint64_t> terrainRestrictions_;
+
+    std::vector<uint64_t> sections_;
+    std::vector<std::vector<uint64_t>> objects_;
+
+    std::vector<uint64_t> civFields_;
+    std::vector<std::vector<uint64_t>> units_;
+
+    void hashSection(DatFile &file, DatFile::Section section);
+
+    void rollUpHeader(void);
+    void rollUpSection(DatFile &file, DatFile::Section section);
+    void rollUpCiv(DatFile &file, size_t civ);
+    void rollUpFile(void);
+};
+}
+
+#endif // GENIE_DATFINGERPRINT_H
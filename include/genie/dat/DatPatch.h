@@ -0,0 +1,156 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GENIE_DATPATCH_H
+#define GENIE_DATPATCH_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "genie/file/IFile.h"
+#include "DatFile.h"
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Changes turning one dat file into another, one entry per changed object.
+///
+/// Objects are the elements of the lists in a dat file, e.g. a graphic, an
+/// effect, a tech or one unit of one civ, and a few singletons like the
+/// terrain block. Two objects are equal if they serialize to the same bytes,
+/// so an entry replaces a whole object. Patches are saved like other files
+/// and only apply to files of the same game version.
+//
+class DatPatch : public IFile
+{
+public:
+    DatPatch();
+    virtual ~DatPatch();
+
+    //----------------------------------------------------------------------------
+    /// What an entry changes. Entries are applied in this order.
+    //
+    enum Item {
+        /// Version string and the scalar members of DatFile.
+        FILE_FIELDS = 0,
+        TERRAIN_RESTRICTIONS,
+        PLAYER_COLOURS,
+        SOUNDS,
+        GRAPHICS,
+        TERRAIN_BLOCK,
+        RANDOM_MAPS,
+        EFFECTS,
+        UNIT_LINES,
+        UNIT_HEADERS,
+        /// Members of a civ except its units.
+        CIVS,
+        /// Units of the civ in Entry::Civ.
+        CIV_UNITS,
+        TECHS,
+        TECH_TREE,
+        ITEM_COUNT
+    };
+
+    //----------------------------------------------------------------------------
+    struct Entry {
+        uint8_t Item = FILE_FIELDS;
+
+        /// Sets the length of the list to Index instead of replacing an
+        /// element.
+        bool Resize = false;
+
+        /// Civ of CIV_UNITS entries, 0 otherwise.
+        uint32_t Civ = 0;
+
+        /// Index of the replaced element or the new length of the list.
+        uint32_t Index = 0;
+
+        /// Pointer of GRAPHICS and CIV_UNITS elements. Elements with pointer
+        /// 0 aren't stored in the file and have no Data.
+        int32_t Pointer = 1;
+
+        /// The new object serialized for the game version of the patch.
+        std::vector<char> Data;
+
+        //--------------------------------------------------------------------------
+        /// @return true if both entries change the same object
+        //
+        bool sameTarget(const Entry &other) const;
+
+        //--------------------------------------------------------------------------
+        /// @return true if both entries change the same object the same way
+        //
+        bool operator==(const Entry &other) const;
+    };
+
+    //----------------------------------------------------------------------------
+    /// Two entries changing the same object differently.
+    //
+    struct Conflict {
+        Entry Ours;
+        Entry Theirs;
+    };
+
+    std::vector<Entry> Entries;
+
+    //----------------------------------------------------------------------------
+    /// Replaces the entries with the changes turning from into to. Sections
+    /// not loaded yet are loaded.
+    ///
+    /// @exception std::invalid_argument if the game versions differ
+    //
+    void diff(DatFile &from, DatFile &to);
+
+    //----------------------------------------------------------------------------
+    /// Changes file as described by the patch. Touched sections are marked
+    /// dirty.
+    ///
+    /// @exception std::invalid_argument if the game versions differ
+    //
+    void apply(DatFile &file) const;
+
+    //----------------------------------------------------------------------------
+    /// Three-way merge, replaces the entries with the combination of two
+    /// patches made against the same base file. Changes made by only one
+    /// side or by both sides alike are taken over. Objects changed
+    /// differently by both sides are reported as conflicts and keep the
+    /// change of ours.
+    ///
+    /// @param conflicts gets the conflicting entries
+    /// @exception std::invalid_argument if the game versions differ
+    //
+    void merge(const DatPatch &ours, const DatPatch &theirs,
+               std::vector<Conflict> &conflicts);
+
+private:
+    static const uint32_t FORMAT = 1;
+
+    //----------------------------------------------------------------------------
+    /// The serialization context of file, used to (de)serialize its objects
+    /// on their own.
+    //
+    static SerializationContext fileContext(DatFile &file);
+
+    virtual void unload(void);
+
+    virtual void serializeObject(void);
+};
+}
+
+#endif // GENIE_DATPATCH_H
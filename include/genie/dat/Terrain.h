@@ -30,10 +30,36 @@ class Terrain : public SharedTerrain
 public:
     Terrain();
     virtual ~Terrain();
+
+    //----------------------------------------------------------------------------
+    /// Sizes Borders for the terrain count of the file while the terrain is
+    /// serialized, for the default count of gv otherwise.
+    //
     virtual void setGameVersion(GameVersion gv);
+
+    //----------------------------------------------------------------------------
+    /// @param terrainCount number of terrains of the file
+    //
+    void setGameVersion(GameVersion gv, unsigned short terrainCount);
+
+    //----------------------------------------------------------------------------
+    /// Default number of terrains of a game version, or the count set with
+    /// setTerrainCount().
+    //
     static unsigned short getTerrainCount(GameVersion gv);
+
+    //----------------------------------------------------------------------------
+    /// Overrides the default number of terrains of all game versions.
+    //
+    [[deprecated("Use DatFile::setTerrainCount()")]]
     static void setTerrainCount(unsigned short cnt);
 
+    //----------------------------------------------------------------------------
+    /// Number of terrains set with DatFile::setTerrainCount(), or the default.
+    //
+    static unsigned short getTerrainCount(const SerializationContext &ctx,
+                                          GameVersion gv);
+
     int8_t IsWater = 0;
     int8_t HideInEditor = 0;
     int32_t StringID = 0;
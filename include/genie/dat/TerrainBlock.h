@@ -46,8 +46,17 @@ class TerrainBlock : public ISerializable
 public:
     TerrainBlock();
     virtual ~TerrainBlock();
+
+    //----------------------------------------------------------------------------
+    /// Sizes Terrains like Terrain::setGameVersion() sizes its borders.
+    //
     virtual void setGameVersion(GameVersion gv);
 
+    //----------------------------------------------------------------------------
+    /// @param terrainCount number of terrains of the file
+    //
+    void setGameVersion(GameVersion gv, unsigned short terrainCount);
+
     int32_t VirtualFunctionPtr;
     int32_t MapPointer;
     int32_t MapWidth;
@@ -29,7 +29,12 @@ namespace genie {
 class TerrainRestriction : public ISerializable
 {
 public:
-    TerrainRestriction();
+    //----------------------------------------------------------------------------
+    /// @param terrainCount number of terrains, DatFile::TerrainsUsed1. 0 uses
+    ///                     the count set with setTerrainCount(). Restrictions
+    ///                     with fewer terrains are padded when written.
+    //
+    TerrainRestriction(unsigned short terrainCount = 0);
     virtual ~TerrainRestriction();
     virtual void setGameVersion(GameVersion gv);
 
@@ -48,6 +53,11 @@ public:
 
     std::vector<TerrainPassGraphic> TerrainPassGraphics;
 
+    //----------------------------------------------------------------------------
+    /// Sets the size of restrictions constructed without a terrain count.
+    /// Reading and writing uses DatFile::TerrainsUsed1.
+    //
+    [[deprecated("Pass the terrain count to the constructor")]]
     static void setTerrainCount(unsigned short cnt);
 
 private:
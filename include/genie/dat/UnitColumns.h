@@ -0,0 +1,255 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENIE_UNITCOLUMNS_H
+#define GENIE_UNITCOLUMNS_H
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include "Civ.h"
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Numeric unit fields of all civs copied into one array per field, for
+/// scanning many units without walking the civ and unit objects.
+///
+/// There is a row for every unit ID of every civ, see row(). Values are
+/// stored as float. Rows of units that don't exist and attacks or armours a
+/// unit doesn't have are NaN, queries skip them.
+///
+/// The columns don't notice changes to the units, call update() for edited
+/// units or build() after adding units or civs.
+//
+class UnitColumns
+{
+public:
+    typedef std::vector<float> Column;
+
+    enum Field {
+        TYPE = 0,
+        CLASS,
+        HIT_POINTS,
+        LINE_OF_SIGHT,
+        GARRISON_CAPACITY,
+        RESOURCE_CAPACITY,
+        SPEED,
+        ROTATION_SPEED,
+        SEARCH_RADIUS,
+        WORK_RATE,
+        BASE_ARMOR,
+        MAX_RANGE,
+        MIN_RANGE,
+        BLAST_WIDTH,
+        RELOAD_TIME,
+        ACCURACY_PERCENT,
+        PROJECTILE_UNIT_ID,
+        DISPLAYED_ATTACK,
+        DISPLAYED_MELEE_ARMOUR,
+        TRAIN_TIME,
+        TRAIN_LOCATION_ID,
+        TOTAL_PROJECTILES,
+        FIELD_COUNT
+    };
+
+    //----------------------------------------------------------------------------
+    /// @param civs civs to copy the units from, usually DatFile::Civs. Has to
+    ///             outlive this object. In lazy mode the civs section has to
+    ///             be loaded.
+    //
+    UnitColumns(const std::vector<Civ> &civs);
+
+    virtual ~UnitColumns();
+
+    //----------------------------------------------------------------------------
+    /// Copies all units again.
+    //
+    void build(void);
+
+    //----------------------------------------------------------------------------
+    /// Copies one unit again. Falls back to build() if the unit is outside
+    /// of the current rows.
+    //
+    void update(size_t civ, size_t unit);
+
+    //----------------------------------------------------------------------------
+    /// Copies all units of one civ again.
+    //
+    void updateCiv(size_t civ);
+
+    //----------------------------------------------------------------------------
+    inline size_t getCivCount(void) const
+    {
+        return civCount_;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Number of rows per civ, the highest unit count of all civs.
+    //
+    inline size_t getUnitCount(void) const
+    {
+        return unitCount_;
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t getRowCount(void) const
+    {
+        return civCount_ * unitCount_;
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t row(size_t civ, size_t unit) const
+    {
+        return civ * unitCount_ + unit;
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t civOf(size_t row) const
+    {
+        return row / unitCount_;
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t unitOf(size_t row) const
+    {
+        return row % unitCount_;
+    }
+
+    //----------------------------------------------------------------------------
+    /// @return true if the row holds a unit
+    //
+    inline bool exists(size_t row) const
+    {
+        return exists_[row] != 0;
+    }
+
+    //----------------------------------------------------------------------------
+    inline const Column &column(Field field) const
+    {
+        return fields_[field];
+    }
+
+    //----------------------------------------------------------------------------
+    /// Attack amounts against class cls.
+    //
+    const Column &attack(int16_t cls) const;
+
+    //----------------------------------------------------------------------------
+    /// Armour amounts of class cls.
+    //
+    const Column &armour(int16_t cls) const;
+
+private:
+    const std::vector<Civ> &civs_;
+
+    size_t civCount_ = 0;
+    size_t unitCount_ = 0;
+
+    std::vector<uint8_t> exists_;
+    std::vector<Column> fields_;
+    std::map<int16_t, Column> attacks_;
+    std::map<int16_t, Column> armours_;
+
+    /// All NaN, returned for classes no unit has.
+    Column missing_;
+
+    UnitColumns(const UnitColumns &other);
+    UnitColumns &operator=(const UnitColumns &other);
+
+    void fillRow(size_t civ, size_t unit);
+
+    static void setAmounts(std::map<int16_t, Column> &columns,
+                           const std::vector<unit::AttackOrArmor> &amounts,
+                           size_t row, size_t rowCount);
+};
+
+//------------------------------------------------------------------------------
+/// Filters rows of UnitColumns and aggregates columns over the remaining
+/// ones.
+///
+/// Starts with every row that holds a unit. Rows where a filtered or
+/// aggregated value is NaN are left out.
+//
+class UnitQuery
+{
+public:
+    enum Comparison {
+        EQUAL = 0,
+        NOT_EQUAL,
+        LESS,
+        LESS_EQUAL,
+        GREATER,
+        GREATER_EQUAL
+    };
+
+    //----------------------------------------------------------------------------
+    /// @param columns has to outlive the query
+    //
+    UnitQuery(const UnitColumns &columns);
+
+    //----------------------------------------------------------------------------
+    /// Keeps rows where column compares to value as given.
+    //
+    UnitQuery &where(const UnitColumns::Column &column, Comparison cmp, float value);
+
+    //----------------------------------------------------------------------------
+    UnitQuery &where(UnitColumns::Field field, Comparison cmp, float value);
+
+    //----------------------------------------------------------------------------
+    /// Keeps rows of one civ.
+    //
+    UnitQuery &civ(size_t civ);
+
+    //----------------------------------------------------------------------------
+    inline const std::vector<uint32_t> &rows(void) const
+    {
+        return rows_;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Values of column in the remaining rows, in row order.
+    //
+    std::vector<float> select(const UnitColumns::Column &column) const;
+
+    //----------------------------------------------------------------------------
+    size_t count(void) const;
+
+    /// Aggregates of the values in one column, all 0 if there are none.
+    struct Summary {
+        size_t count = 0;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+        double mean = 0;
+    };
+
+    //----------------------------------------------------------------------------
+    Summary summarize(const UnitColumns::Column &column) const;
+
+    //----------------------------------------------------------------------------
+    Summary summarize(UnitColumns::Field field) const;
+
+private:
+    const UnitColumns &columns_;
+    std::vector<uint32_t> rows_;
+};
+}
+
+#endif // GENIE_UNITCOLUMNS_H
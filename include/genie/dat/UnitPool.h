@@ -0,0 +1,69 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENIE_UNITPOOL_H
+#define GENIE_UNITPOOL_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "genie/file/MemoryStream.h"
+#include "Unit.h"
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Set of units where equal units are stored only once. Most units are the
+/// same for every civ, civs loaded through one pool share them.
+///
+/// The pool is only needed while interning, the units stay alive as long as
+/// anything refers to them.
+//
+class UnitPool
+{
+public:
+    UnitPool();
+    virtual ~UnitPool();
+
+    UnitPool(const UnitPool &) = delete;
+    UnitPool &operator=(const UnitPool &) = delete;
+
+    //----------------------------------------------------------------------------
+    /// Returns the pooled unit equal to unit, or adds unit to the pool if
+    /// there is none. Units are equal if they serialize to the same bytes.
+    ///
+    /// @param unit read unit, moved from if added
+    //
+    std::shared_ptr<Unit> intern(Unit &unit);
+
+    //----------------------------------------------------------------------------
+    /// @return number of different units in the pool
+    //
+    size_t size(void) const;
+
+private:
+    /// Serialized unit to the unit.
+    std::unordered_map<std::string, std::shared_ptr<Unit>> units_;
+
+    /// Buffer to serialize units into, reused for every unit.
+    MemoryOStream key_;
+};
+}
+
+#endif // GENIE_UNITPOOL_H
@@ -0,0 +1,101 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENIE_COMPRESSIONBACKEND_H
+#define GENIE_COMPRESSIONBACKEND_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Library (de)compressing complete raw deflate streams held in memory.
+///
+/// Which backends are available is decided at build time, see the
+/// GUTILS_WITH_* options in CMakeLists.txt. Streaming decompression always
+/// goes through zstr and the zlib the library is linked with.
+//
+class CompressionBackend
+{
+public:
+    enum Type {
+        ZLIB = 0,
+        ZLIB_NG,
+        LIBDEFLATE,
+        MINIZ,
+        TYPE_COUNT
+    };
+
+    virtual ~CompressionBackend() {}
+
+    //----------------------------------------------------------------------------
+    virtual Type type(void) const = 0;
+
+    //----------------------------------------------------------------------------
+    virtual const char *name(void) const = 0;
+
+    //----------------------------------------------------------------------------
+    /// Highest compression level, higher levels passed to deflateRaw are
+    /// lowered to it.
+    //
+    virtual int maxLevel(void) const = 0;
+
+    //----------------------------------------------------------------------------
+    /// Inflates a raw deflate stream (window bits -15). Data following the
+    /// end of the stream is ignored.
+    ///
+    /// @param src compressed data
+    /// @param size size of src
+    /// @param dest gets the uncompressed data
+    /// @return false if the data is corrupt
+    //
+    virtual bool inflateRaw(const char *src, size_t size,
+                            std::vector<char> &dest) const = 0;
+
+    //----------------------------------------------------------------------------
+    /// Deflates data into a single raw deflate stream.
+    ///
+    /// @param src uncompressed data
+    /// @param size size of src
+    /// @param level compression level, 0 (stored) to maxLevel()
+    /// @param dest gets the compressed data
+    /// @return false if the backend can't compress with the level
+    //
+    virtual bool deflateRaw(const char *src, size_t size, int level,
+                            std::vector<char> &dest) const = 0;
+
+    //----------------------------------------------------------------------------
+    /// @return the backend or 0 if it isn't compiled in
+    //
+    static const CompressionBackend *get(Type type);
+
+    //----------------------------------------------------------------------------
+    /// The fastest available backend, libdeflate, zlib-ng, zlib, miniz in that
+    /// order.
+    //
+    static const CompressionBackend *getDefault(void);
+
+    //----------------------------------------------------------------------------
+    /// @return all compiled in backends
+    //
+    static std::vector<Type> available(void);
+};
+}
+
+#endif // GENIE_COMPRESSIONBACKEND_H
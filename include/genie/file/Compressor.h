@@ -23,6 +23,7 @@
 #include <iostream>
 #include <memory>
 #include "ISerializable.h"
+#include "CompressionBackend.h"
 
 namespace genie {
 
@@ -33,6 +34,40 @@ namespace genie {
 class Compressor
 {
 public:
+    //----------------------------------------------------------------------------
+    /// How compressed data is fed to the object while reading.
+    //
+    enum DecompressionMode {
+        /// Inflate in the reading thread while the object reads.
+        DECOMPRESS_STREAMING = 0,
+
+        /// Inflate everything into memory first and read from there.
+        DECOMPRESS_IN_MEMORY,
+
+        /// Inflate in a second thread into a ring of large blocks while the
+        /// object reads the blocks already done.
+        DECOMPRESS_PIPELINED
+    };
+
+    //----------------------------------------------------------------------------
+    /// Compression level presets for writing. All produce plain deflate data
+    /// the games can read.
+    //
+    enum CompressionProfile {
+        /// Uncompressed data in deflate blocks (level 0), the default.
+        COMPRESSION_STORED = 0,
+
+        /// Fastest real compression (level 1), for saving often while
+        /// editing.
+        COMPRESSION_FAST,
+
+        /// Highest level of the backend, for release files.
+        COMPRESSION_MAX
+    };
+
+    /// Passing this as level uses the highest level of the backend.
+    static const int MAX_LEVEL = 12;
+
     Compressor(const Compressor &) = delete;
     Compressor &operator=(const Compressor &) = delete;
 
@@ -53,16 +88,74 @@ public:
     void endCompression(void);
 
     //----------------------------------------------------------------------------
-    static void decompress(std::istream &source, std::ostream &sink);
+    /// Inflates everything left in source into sink. The data is inflated in
+    /// one go by backend and written as one block, if that fails zstr is
+    /// used with large blocks.
+    ///
+    /// @return number of uncompressed bytes written to sink
+    //
+    static std::size_t decompress(std::istream &source, std::ostream &sink,
+                                  const CompressionBackend *backend = CompressionBackend::getDefault());
+
+    //----------------------------------------------------------------------------
+    inline void setDecompressionMode(DecompressionMode mode)
+    {
+        decompressionMode_ = mode;
+    }
+
+    //----------------------------------------------------------------------------
+    inline DecompressionMode getDecompressionMode(void) const
+    {
+        return decompressionMode_;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Selects the library used when the whole data is in memory, which is
+    /// when writing and when decompressing with DECOMPRESS_IN_MEMORY.
+    /// Defaults to CompressionBackend::getDefault().
+    ///
+    /// @return false if the backend isn't compiled in
+    //
+    bool setCompressionBackend(CompressionBackend::Type type);
+
+    //----------------------------------------------------------------------------
+    inline const CompressionBackend *getCompressionBackend(void) const
+    {
+        return backend_;
+    }
+
+    //----------------------------------------------------------------------------
+    void setCompressionProfile(CompressionProfile profile);
+
+    //----------------------------------------------------------------------------
+    /// @param level 0 (stored) to MAX_LEVEL, lowered to what the backend
+    ///              supports
+    //
+    inline void setCompressionLevel(int level)
+    {
+        level_ = level;
+    }
+
+    //----------------------------------------------------------------------------
+    inline int getCompressionLevel(void) const
+    {
+        return level_;
+    }
 
 private:
     ISerializable *obj_;
 
+    DecompressionMode decompressionMode_ = DECOMPRESS_STREAMING;
+    const CompressionBackend *backend_ = CompressionBackend::getDefault();
+    int level_ = 0;
+
     std::istream *istream_ = 0;
     std::shared_ptr<std::istream> uncompressedIstream_;
 
-    std::ostream *ostream_;
-    std::shared_ptr<std::ostream> bufferedStream_;
+    std::ostream *ostream_ = 0;
+
+    /// Collects the uncompressed data, kept to reuse its memory next time.
+    std::shared_ptr<MemoryOStream> bufferedStream_;
 
     Compressor();
 
@@ -24,9 +24,12 @@
 #include "ISerializable.h"
 
 #include <fstream>
+#include <memory>
 
 namespace genie {
 
+class MappedFile;
+
 //------------------------------------------------------------------------------
 /// Interface providing file loading and saving for ISerializable objects.
 //
@@ -57,6 +60,21 @@ public:
     //
     const char *getFileName(void) const;
 
+    //----------------------------------------------------------------------------
+    /// If enabled, load() maps the file into memory instead of opening a
+    /// stream. Objects loaded from the file can then point into the mapping
+    /// instead of copying their data. Has to be set before loading.
+    ///
+    /// @param mapped true to memory map files on load
+    //
+    void setMemoryMapped(bool mapped);
+
+    //----------------------------------------------------------------------------
+    inline bool isMemoryMapped(void) const
+    {
+        return memoryMapped_;
+    }
+
     //----------------------------------------------------------------------------
     /// Loads the object from file. Can only be called if fileName is already set.
     ///
@@ -85,7 +103,8 @@ public:
     void save();
 
     //----------------------------------------------------------------------------
-    /// Saves data to a different file.
+    /// Saves data to a different file. The file is written to fileName.tmp
+    /// first and renamed when complete.
     ///
     /// @param fileName file name
     /// @exception std::ios_base::failure thrown if file can't be written (
@@ -100,11 +119,23 @@ protected:
     //
     virtual void unload(void);
 
+    //----------------------------------------------------------------------------
+    /// Writes data to fileName.tmp and renames it to fileName when complete,
+    /// so fileName is never left half written.
+    ///
+    /// @exception std::ios_base::failure thrown if the file can't be written
+    //
+    static void writeFile(const char *fileName, const char *data, size_t size);
+
 private:
     std::string fileName_;
 
     std::ifstream fileIn_;
 
+    bool memoryMapped_ = false;
+    std::shared_ptr<MappedFile> mapping_;
+    std::unique_ptr<MemoryIStream> mappedIn_;
+
     bool loaded_ = false;
 };
 }
@@ -24,13 +24,51 @@
 #include <iostream>
 
 #include "genie/Types.h"
+#include "genie/file/MemoryStream.h"
 #include <array>
+#include <memory>
 #include <vector>
 #include <string.h>
 #include <stdint.h>
+#include <type_traits>
 
 namespace genie {
 
+class UnitPool;
+
+//------------------------------------------------------------------------------
+/// Versions and counts read from one part of a file that decide how other
+/// parts of the same file are laid out.
+///
+/// Every root object owns one, subobjects use the one of the object they are
+/// serialized from. Loading different files in different threads is safe.
+//
+struct SerializationContext {
+    /// 6 to 12
+    float dat_internal_ver = 0.f;
+
+    /// "1.00" to "1.21"
+    std::string scn_ver = "0.00";
+
+    /// 1.0 to 1.30
+    float scn_plr_data_ver = 0.f, scn_internal_ver = 0.f;
+
+    /// 1.0 to 1.6
+    double scn_trigger_ver = 0.0;
+
+    /// Number of terrains, 0 uses the default of the game version.
+    unsigned short terrain_count = 0;
+
+    /// Number of terrains in each terrain restriction.
+    unsigned short terrain_restriction_count = 0;
+
+    /// Set while reading the resources of scenario player data 4.
+    bool player_info = false;
+
+    /// Civs intern their units here while reading, if set.
+    UnitPool *unit_pool = 0;
+};
+
 //------------------------------------------------------------------------------
 /// Generic base class for genie file serialization
 //
@@ -65,6 +103,16 @@ public:
     //
     void readObject(std::istream &istr);
 
+    //----------------------------------------------------------------------------
+    /// Read object from a block of memory. Fields are copied straight out of
+    /// the block, which is a lot faster than reading them through a stream.
+    ///
+    /// @param data first byte of the block, only needs to stay valid during
+    ///             the call
+    /// @param size size of the block in bytes
+    //
+    void readObject(const char *data, size_t size);
+
     //----------------------------------------------------------------------------
     /// Write object to stream.
     ///
@@ -73,7 +121,7 @@ public:
     void writeObject(std::ostream &ostr);
 
     //----------------------------------------------------------------------------
-    /// Returns size in bytes.
+    /// Returns size in bytes. Every object in the tree is visited once.
     //
     virtual size_t objectSize(void);
 
@@ -103,10 +151,11 @@ public:
     template <typename T>
     static void updateGameVersion(GameVersion gv, std::vector<T> &vec)
     {
-        for (auto &it : vec) {
-            ISerializable *item = dynamic_cast<ISerializable *>(&it);
-            item->setGameVersion(gv);
-        }
+        static_assert(std::is_base_of<ISerializable, T>::value,
+                      "T has to inherit ISerializable");
+
+        for (auto &it : vec)
+            it.setGameVersion(gv);
     }
 
     //----------------------------------------------------------------------------
@@ -114,21 +163,6 @@ public:
     //
     friend class Compressor;
 
-    //----------------------------------------------------------------------------
-    /// Versions used to read/write/paste.
-
-    /// 6 to 12
-    static float dat_internal_ver;
-
-    /// "1.00" to "1.21"
-    static std::string scn_ver;
-
-    /// 1.0 to 1.30
-    static float scn_plr_data_ver, scn_internal_ver;
-
-    /// 1.0 to 1.6
-    static double scn_trigger_ver;
-
 protected:
     enum Operation {
         OP_READ = 0,
@@ -136,12 +170,46 @@ protected:
         OP_CALC_SIZE = 2
     };
 
+    //----------------------------------------------------------------------------
+    /// Versions used to read/write/paste. Belongs to the root object of the
+    /// current operation, outside of one it's the context of this object.
+    //
+    inline SerializationContext &context(void)
+    {
+        if (context_.root)
+            return *context_.root;
+
+        if (!ownContext_)
+            ownContext_ = std::make_shared<SerializationContext>();
+
+        return *ownContext_;
+    }
+
+    //----------------------------------------------------------------------------
+    /// @return the context of the root object while this object is serialized
+    ///         as its subobject, 0 otherwise. setGameVersion() is called both
+    ///         during and outside of operations.
+    //
+    inline const SerializationContext *rootContext(void) const
+    {
+        return context_.root;
+    }
+
     /// Updates the gv of all objects with the gv of this object.
     //
     template <typename T>
     void updateGameVersion(std::vector<T> &vec)
     {
-        updateGameVersion<T>(getGameVersion(), vec);
+        for (auto &it : vec)
+            updateGameVersion(it);
+    }
+
+    //----------------------------------------------------------------------------
+    /// Updates the gv of a subobject like updateGameVersion(vec).
+    //
+    inline void updateGameVersion(ISerializable &sub)
+    {
+        sub.setGameVersion(getGameVersion());
     }
 
     //----------------------------------------------------------------------------
@@ -178,6 +246,17 @@ protected:
     inline void setIStream(std::istream &istr)
     {
         istr_ = &istr;
+        ibuf_ = dynamic_cast<MemoryReadBuffer *>(istr.rdbuf());
+    }
+
+    //----------------------------------------------------------------------------
+    /// Forgets the istream, for objects that outlive the stream they were read
+    /// from.
+    //
+    inline void resetIStream(void)
+    {
+        istr_ = 0;
+        ibuf_ = 0;
     }
 
     //----------------------------------------------------------------------------
@@ -186,10 +265,19 @@ protected:
         return istr_;
     }
 
+    //----------------------------------------------------------------------------
+    /// @return buffer of the current istream if it reads from memory, else 0.
+    //
+    inline MemoryReadBuffer *getIBuffer(void)
+    {
+        return ibuf_;
+    }
+
     //----------------------------------------------------------------------------
     inline void setOStream(std::ostream &ostr)
     {
         ostr_ = &ostr;
+        obuf_ = dynamic_cast<MemoryWriteBuffer *>(ostr.rdbuf());
     }
 
     //----------------------------------------------------------------------------
@@ -198,6 +286,14 @@ protected:
         return ostr_;
     }
 
+    //----------------------------------------------------------------------------
+    /// @return buffer of the current ostream if it writes to memory, else 0.
+    //
+    inline MemoryWriteBuffer *getOBuffer(void)
+    {
+        return obuf_;
+    }
+
     //----------------------------------------------------------------------------
     /// @return position of the istreams get pointer.
     //
@@ -226,13 +322,18 @@ protected:
     //
     std::string readString(size_t len);
 
+    //----------------------------------------------------------------------------
+    /// Like readString(size_t), but reads into str, reusing its memory.
+    //
+    void readString(std::string &str, size_t len);
+
     //----------------------------------------------------------------------------
     /// Writes a string to ostr.
     ///
     /// @param str string to write
     /// @param len number of chars to write.
     //
-    void writeString(std::string str, size_t len);
+    void writeString(const std::string &str, size_t len);
 
     //----------------------------------------------------------------------------
     /// Generic read method for basic data types.
@@ -244,12 +345,26 @@ protected:
     {
         T ret = {};
 
+        if (ibuf_ && ibuf_->read(&ret, sizeof(ret)))
+            return ret;
+
         if (!istr_->eof())
             istr_->read(reinterpret_cast<char *>(&ret), sizeof(ret));
 
         return ret;
     }
 
+    //----------------------------------------------------------------------------
+    /// Writes len raw bytes, directly to memory if possible.
+    //
+    inline void writeBytes(const void *src, size_t len)
+    {
+        if (obuf_)
+            obuf_->write(src, len);
+        else
+            ostr_->write(static_cast<const char *>(src), len);
+    }
+
     //----------------------------------------------------------------------------
     /// Generic write method for basic data types.
     ///
@@ -258,7 +373,51 @@ protected:
     template <typename T>
     void write(T &data)
     {
-        ostr_->write(reinterpret_cast<char *>(&data), sizeof(T));
+        writeBytes(&data, sizeof(T));
+    }
+
+    //----------------------------------------------------------------------------
+    /// True if arrays of T can be copied in one block. Values are stored the
+    /// way they are in memory, so like the rest of the library this assumes
+    /// a little endian host.
+    //
+    template <typename T>
+    static constexpr bool isBlockCopyable(void)
+    {
+        return std::is_trivially_copyable<T>::value;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Reads len values into dest, in one block if possible.
+    //
+    template <typename T>
+    void readArray(T *dest, size_t len)
+    {
+        if constexpr (isBlockCopyable<T>()) {
+            if (len == 0 || (ibuf_ && ibuf_->read(dest, sizeof(T) * len)))
+                return;
+
+            if (!istr_->eof())
+                istr_->read(reinterpret_cast<char *>(dest), sizeof(T) * len);
+        } else {
+            for (size_t i = 0; i < len; ++i)
+                dest[i] = read<T>();
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    /// Writes len values from src, in one block if possible.
+    //
+    template <typename T>
+    void writeArray(T *src, size_t len)
+    {
+        if constexpr (isBlockCopyable<T>()) {
+            if (len > 0)
+                writeBytes(src, sizeof(T) * len);
+        } else {
+            for (size_t i = 0; i < len; ++i)
+                write<T>(src[i]);
+        }
     }
 
     //----------------------------------------------------------------------------
@@ -271,7 +430,7 @@ protected:
             if (*array == 0)
                 *array = new T[len];
 
-            istr_->read(reinterpret_cast<char *>(*array), sizeof(T) * len);
+            readArray<T>(*array, len);
         }
     }
 
@@ -281,7 +440,7 @@ protected:
     template <typename T>
     void write(T **data, size_t len)
     {
-        ostr_->write(reinterpret_cast<char *>(*data), sizeof(T) * len);
+        writeArray<T>(*data, len);
     }
 
     // Serializes a string with debug data.
@@ -314,7 +473,7 @@ protected:
     void serializeForcedString(std::string &str)
     {
         T size;
-        if (isOperation(OP_WRITE)) {
+        if (!isOperation(OP_READ)) {
             size = str.size() + 1;
         }
         serialize<T>(size);
@@ -359,7 +518,7 @@ protected:
         data.serializeSubObject(this);
 
         if (isOperation(OP_CALC_SIZE))
-            size_ += data.objectSize();
+            size_ += data.size_;
     }
 
     //----------------------------------------------------------------------------
@@ -392,7 +551,7 @@ protected:
                 writeString(str, len);
                 break;
             case OP_READ:
-                str = readString(len);
+                readString(str, len);
                 break;
             case OP_CALC_SIZE:
                 size_ += sizeof(char) * len;
@@ -412,16 +571,14 @@ protected:
             if (vec.size() != size)
                 std::cerr << "Warning!: vector size differs len!" << vec.size() << " " << size << std::endl;
 
-            for (auto it = vec.begin(); it != vec.end(); ++it)
-                write<T>(*it);
+            writeArray<T>(vec.data(), vec.size());
 
             break;
 
         case OP_READ:
             vec.resize(size);
 
-            for (size_t i = 0; i < size; ++i)
-                vec[i] = read<T>();
+            readArray<T>(vec.data(), size);
 
             break;
 
@@ -443,8 +600,7 @@ protected:
                 std::cerr << "Warning!: vector size differs len!" << vec.size() << " " << size << std::endl;
 
             for (size_t i = 0; i < size; ++i)
-                for (auto it = vec[i].begin(); it != vec[i].end(); ++it)
-                    write<T>(*it);
+                writeArray<T>(vec[i].data(), vec[i].size());
 
             break;
 
@@ -453,8 +609,7 @@ protected:
 
             for (size_t i = 0; i < size; ++i) {
                 vec[i].resize(size2);
-                for (size_t j = 0; j < size2; ++j)
-                    vec[i][j] = read<T>();
+                readArray<T>(vec[i].data(), size2);
             }
 
             break;
@@ -471,36 +626,35 @@ protected:
     template <typename T>
     void serializeSub(std::vector<T> &vec, size_t size)
     {
+        static_assert(std::is_base_of<ISerializable, T>::value,
+                      "T has to inherit ISerializable");
+
         if (isOperation(OP_WRITE) || isOperation(OP_CALC_SIZE)) {
             if (vec.size() != size)
                 std::cerr << "Warning!: vector size differs size!" << vec.size() << " " << size << std::endl;
 
-            for (auto it = vec.begin(); it != vec.end(); ++it) {
-                ISerializable *data = dynamic_cast<ISerializable *>(&(*it));
-
-                data->serializeSubObject(this);
+            for (T &data : vec) {
+                data.serializeSubObject(this);
 
                 if (isOperation(OP_CALC_SIZE))
-                    size_ += data->objectSize();
+                    size_ += data.size_;
             }
         } else {
             vec.resize(size);
 
-            for (size_t i = 0; i < size; ++i) {
-                ISerializable *cast_obj = dynamic_cast<ISerializable *>(&vec[i]);
-                cast_obj->serializeSubObject(this);
-            }
+            for (T &data : vec)
+                data.serializeSubObject(this);
         }
     }
 
     //----------------------------------------------------------------------------
     /// Serialize a vector size number. If size differs, the number will be
-    /// updated.
+    /// updated. Anything but reading takes the size from the vector.
     //
     template <typename T>
     void serializeSize(T &data, size_t size)
     {
-        if (isOperation(OP_WRITE))
+        if (!isOperation(OP_READ))
             data = size;
 
         serialize<T>(data);
@@ -514,10 +668,10 @@ protected:
     /// @param c_str true if cstring (ending with \0).
     ///
     template <typename T>
-    void serializeSize(T &data, std::string str, bool cString = true)
+    void serializeSize(T &data, const std::string &str, bool cString = true)
     {
         // calculate new size
-        if (isOperation(OP_WRITE)) {
+        if (!isOperation(OP_READ)) {
             size_t size = str.size();
 
             if (cString && size != 0)
@@ -538,24 +692,54 @@ protected:
     void serializeSubWithPointers(std::vector<T> &vec, size_t size,
                                   std::vector<int32_t> &pointers)
     {
+        static_assert(std::is_base_of<ISerializable, T>::value,
+                      "T has to inherit ISerializable");
+
         if (isOperation(OP_WRITE) || isOperation(OP_CALC_SIZE)) {
             for (size_t i = 0; i < size; ++i) {
                 if (pointers[i]) {
-                    ISerializable *data = dynamic_cast<ISerializable *>(&vec[i]);
-                    data->serializeSubObject(this);
+                    vec[i].serializeSubObject(this);
 
                     if (isOperation(OP_CALC_SIZE))
-                        size_ += data->objectSize();
+                        size_ += vec[i].size_;
                 }
             }
         } else {
             vec.resize(size);
+            for (size_t i = 0; i < size; ++i) {
+                if (pointers[i])
+                    vec[i].serializeSubObject(this);
+            }
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    /// Same as above for objects that may be shared with other vectors.
+    //
+    template <typename T>
+    void serializeSubWithPointers(std::vector<std::shared_ptr<T>> &vec,
+                                  size_t size, std::vector<int32_t> &pointers)
+    {
+        static_assert(std::is_base_of<ISerializable, T>::value,
+                      "T has to inherit ISerializable");
+
+        if (isOperation(OP_WRITE) || isOperation(OP_CALC_SIZE)) {
             for (size_t i = 0; i < size; ++i) {
                 if (pointers[i]) {
-                    ISerializable *cast_obj = dynamic_cast<ISerializable *>(&vec[i]);
-                    cast_obj->serializeSubObject(this);
+                    vec[i]->serializeSubObject(this);
+
+                    if (isOperation(OP_CALC_SIZE))
+                        size_ += vec[i]->size_;
                 }
             }
+        } else {
+            vec.resize(size);
+            for (size_t i = 0; i < size; ++i) {
+                vec[i] = std::make_shared<T>();
+
+                if (pointers[i])
+                    vec[i]->serializeSubObject(this);
+            }
         }
     }
 
@@ -568,19 +752,21 @@ protected:
     template <typename T>
     void serializePair(std::pair<T, T> &p, bool only_first = false)
     {
+        // std::pair makes no promise about its layout, go through an array.
+        T values[2] = { p.first, p.second };
+        size_t len = only_first ? 1 : 2;
+
         switch (getOperation()) {
         case OP_WRITE:
-            write<T>(p.first);
-
-            if (!only_first)
-                write<T>(p.second);
+            writeArray<T>(values, len);
             break;
 
         case OP_READ:
-            p.first = read<T>();
+            readArray<T>(values, len);
 
+            p.first = values[0];
             if (!only_first)
-                p.second = read<T>();
+                p.second = values[1];
             break;
 
         case OP_CALC_SIZE:
@@ -596,13 +782,60 @@ private:
     std::istream *istr_ = 0;
     std::ostream *ostr_ = 0;
 
+    /// Set if istr_ reads from memory, allows skipping the stream on reads.
+    MemoryReadBuffer *ibuf_ = 0;
+
+    /// Set if ostr_ writes to memory, allows skipping the stream on writes.
+    MemoryWriteBuffer *obuf_ = 0;
+
     std::streampos init_read_pos_ = 0;
 
-    Operation operation_;
+    Operation operation_ = OP_READ;
 
     GameVersion gameVersion_ = GV_None;
 
-    size_t size_;
+    /// Size of this object, summed up during OP_CALC_SIZE.
+    size_t size_ = 0;
+
+    //----------------------------------------------------------------------------
+    /// Context of the root object, set only while this object is serialized as
+    /// a subobject. Copies don't take it over.
+    //
+    struct ContextBinding {
+        SerializationContext *root = 0;
+
+        ContextBinding() {}
+        ContextBinding(const ContextBinding &) {}
+        ContextBinding &operator=(const ContextBinding &) { return *this; }
+    };
+
+    //----------------------------------------------------------------------------
+    /// Binds an object to a context for the lifetime of the scope.
+    //
+    class ContextScope
+    {
+    public:
+        ContextScope(ISerializable &object, SerializationContext *root) :
+            object_(object),
+            previous_(object.context_.root)
+        {
+            object.context_.root = root;
+        }
+
+        ~ContextScope()
+        {
+            object_.context_.root = previous_;
+        }
+
+    private:
+        ISerializable &object_;
+        SerializationContext *previous_;
+    };
+
+    ContextBinding context_;
+
+    /// Created the first time this object is serialized as root.
+    std::shared_ptr<SerializationContext> ownContext_;
 };
 
 //----------------------------------------------------------------------------
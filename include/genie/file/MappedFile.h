@@ -0,0 +1,71 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENIE_MAPPEDFILE_H
+#define GENIE_MAPPEDFILE_H
+
+#include <string>
+#include <stddef.h>
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Read only memory mapping of a whole file.
+//
+class MappedFile
+{
+public:
+    //----------------------------------------------------------------------------
+    /// Maps the file into memory.
+    ///
+    /// @param fileName file to map
+    /// @exception std::ios_base::failure thrown if the file can't be mapped
+    //
+    MappedFile(const std::string &fileName);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    //----------------------------------------------------------------------------
+    /// Unmaps the file.
+    //
+    ~MappedFile();
+
+    //----------------------------------------------------------------------------
+    inline const char *data(void) const
+    {
+        return data_;
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t size(void) const
+    {
+        return size_;
+    }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void *mappingHandle_ = nullptr;
+#endif
+};
+}
+
+#endif // GENIE_MAPPEDFILE_H
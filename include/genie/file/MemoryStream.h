@@ -0,0 +1,222 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENIE_MEMORYSTREAM_H
+#define GENIE_MEMORYSTREAM_H
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string.h>
+#include <vector>
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Read only stream buffer over a contiguous block of memory.
+///
+/// ISerializable recognizes this buffer and reads fields straight from the
+/// memory block instead of going through std::istream::read. Other code can
+/// still use it like any other seekable istream.
+//
+class MemoryReadBuffer : public std::streambuf
+{
+public:
+    //----------------------------------------------------------------------------
+    /// @param data first byte of the block, has to outlive the buffer
+    /// @param size number of bytes in the block
+    //
+    MemoryReadBuffer(const char *data, size_t size);
+
+    //----------------------------------------------------------------------------
+    /// Copies len bytes to dest and advances the read position.
+    ///
+    /// @return false without reading anything if less than len bytes are left
+    //
+    inline bool read(void *dest, size_t len)
+    {
+        if (size_t(egptr() - gptr()) < len)
+            return false;
+
+        memcpy(dest, gptr(), len);
+        setg(eback(), gptr() + len, egptr());
+
+        return true;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Advances the read position by len bytes without copying them.
+    ///
+    /// @return the skipped bytes, or 0 if less than len bytes are left
+    //
+    inline const char *take(size_t len)
+    {
+        if (size_t(egptr() - gptr()) < len)
+            return 0;
+
+        const char *ret = gptr();
+        setg(eback(), gptr() + len, egptr());
+
+        return ret;
+    }
+
+    //----------------------------------------------------------------------------
+    inline const char *data(void) const
+    {
+        return eback();
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t size(void) const
+    {
+        return egptr() - eback();
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t position(void) const
+    {
+        return gptr() - eback();
+    }
+
+    //----------------------------------------------------------------------------
+    /// Object keeping the memory block alive, e. g. a MappedFile. Objects
+    /// loaded from this buffer can hold on to it to keep pointers into the
+    /// block after the buffer is gone.
+    //
+    inline void setOwner(std::shared_ptr<const void> owner)
+    {
+        owner_ = std::move(owner);
+    }
+
+    //----------------------------------------------------------------------------
+    inline const std::shared_ptr<const void> &owner(void) const
+    {
+        return owner_;
+    }
+
+protected:
+    std::streamsize xsgetn(char *dest, std::streamsize count) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which = std::ios_base::in) override;
+    pos_type seekpos(pos_type pos,
+                     std::ios_base::openmode which = std::ios_base::in) override;
+
+private:
+    std::shared_ptr<const void> owner_;
+};
+
+//------------------------------------------------------------------------------
+/// Input stream reading from a MemoryReadBuffer.
+//
+class MemoryIStream : public std::istream
+{
+public:
+    MemoryIStream(const char *data, size_t size);
+
+    MemoryIStream(const MemoryIStream &) = delete;
+    MemoryIStream &operator=(const MemoryIStream &) = delete;
+
+    //----------------------------------------------------------------------------
+    inline MemoryReadBuffer *buffer(void)
+    {
+        return &buffer_;
+    }
+
+private:
+    MemoryReadBuffer buffer_;
+};
+
+//------------------------------------------------------------------------------
+/// Stream buffer collecting everything written to it in one growing block of
+/// memory.
+///
+/// ISerializable recognizes this buffer and appends fields directly, so
+/// objects can be serialized without a stream call per field and the result
+/// written out at once.
+//
+class MemoryWriteBuffer : public std::streambuf
+{
+public:
+    //----------------------------------------------------------------------------
+    /// @param reserve number of bytes to allocate up front
+    //
+    MemoryWriteBuffer(size_t reserve = 0);
+
+    //----------------------------------------------------------------------------
+    /// Appends len bytes from src.
+    //
+    inline void write(const void *src, size_t len)
+    {
+        const char *begin = static_cast<const char *>(src);
+        data_.insert(data_.end(), begin, begin + len);
+    }
+
+    //----------------------------------------------------------------------------
+    inline const char *data(void) const
+    {
+        return data_.data();
+    }
+
+    //----------------------------------------------------------------------------
+    inline size_t size(void) const
+    {
+        return data_.size();
+    }
+
+    //----------------------------------------------------------------------------
+    /// Drops the content but keeps the memory for the next use.
+    //
+    inline void clear(void)
+    {
+        data_.clear();
+    }
+
+protected:
+    std::streamsize xsputn(const char *src, std::streamsize count) override;
+    int_type overflow(int_type c) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which = std::ios_base::out) override;
+
+private:
+    std::vector<char> data_;
+};
+
+//------------------------------------------------------------------------------
+/// Output stream writing to a MemoryWriteBuffer.
+//
+class MemoryOStream : public std::ostream
+{
+public:
+    MemoryOStream(size_t reserve = 0);
+
+    MemoryOStream(const MemoryOStream &) = delete;
+    MemoryOStream &operator=(const MemoryOStream &) = delete;
+
+    //----------------------------------------------------------------------------
+    inline MemoryWriteBuffer *buffer(void)
+    {
+        return &buffer_;
+    }
+
+private:
+    MemoryWriteBuffer buffer_;
+};
+}
+
+#endif // GENIE_MEMORYSTREAM_H
@@ -22,6 +22,9 @@
 
 #include <vector>
 #include <list>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <stdint.h>
 
@@ -29,10 +32,13 @@
 #include "SlpFile.h"
 #include "BinaFile.h"
 #include "UIFile.h"
+#include "WavData.h"
 
 namespace genie {
 
 class Logger;
+class MemoryIStream;
+class ResourceCache;
 
 //------------------------------------------------------------------------------
 /// Base class for .drs files
@@ -51,6 +57,38 @@ public:
     //
     virtual ~DrsFile();
 
+    //----------------------------------------------------------------------------
+    /// In concurrent mode the getters can be called from several threads at
+    /// once. The file is memory mapped and every call reads through its own
+    /// stream over the mapping instead of seeking the shared one, slp files
+    /// are read once. Has to be set before loading.
+    ///
+    /// @param concurrent true to enable concurrent access, also enables
+    ///                   memory mapping
+    //
+    void setConcurrentAccess(bool concurrent);
+
+    //----------------------------------------------------------------------------
+    inline bool isConcurrentAccess(void) const
+    {
+        return concurrent_;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Keeps slp files and palettes in a cache instead of holding them until
+    /// the file is destroyed. The cache can be shared by several files.
+    ///
+    /// @param cache cache to use or an empty pointer to hold resources
+    ///              forever
+    //
+    void setResourceCache(std::shared_ptr<ResourceCache> cache);
+
+    //----------------------------------------------------------------------------
+    inline const std::shared_ptr<ResourceCache> &getResourceCache(void) const
+    {
+        return cache_;
+    }
+
     //----------------------------------------------------------------------------
     /// Get a shared pointer to a slp file.
     ///
@@ -59,6 +97,24 @@ public:
     //
     SlpFilePtr getSlpFile(uint32_t id);
 
+    //----------------------------------------------------------------------------
+    /// Loads slp files in the background, so their first getSlpFile() doesn't
+    /// stall. Files are read in the order they are stored in, by a pool of
+    /// threads, and kept like files loaded by getSlpFile(): in the resource
+    /// cache if one is set, where holding the returned pointers keeps them.
+    ///
+    /// Without concurrent access the files are loaded on the calling thread
+    /// before returning. The DrsFile has to outlive the future.
+    ///
+    /// @param ids resource ids, files that aren't found are left empty
+    /// @param decodeFrames also decode the images of all frames
+    /// @param threads number of threads, 0 for one per core
+    /// @return the files in the order of ids, rethrows the first error
+    //
+    std::future<std::vector<SlpFilePtr>> prefetchSlpFiles(std::vector<uint32_t> ids,
+                                                          bool decodeFrames = false,
+                                                          unsigned threads = 0);
+
     //----------------------------------------------------------------------------
     /// Get a shared pointer to a color palette file.
     ///
@@ -66,6 +122,14 @@ public:
     /// @return bina file pointer or "empty" shared pointer if not found
     //
     const PalFile &getPalFile(uint32_t id);
+
+    //----------------------------------------------------------------------------
+    /// Like getPalFile(), but a palette kept in the resource cache stays
+    /// valid as long as the pointer is held.
+    ///
+    /// @return palette or an empty pointer if not found
+    //
+    std::shared_ptr<PalFile> getPalFilePtr(uint32_t id);
     UIFilePtr getUIFile(uint32_t id);
     UIFilePtr getUIFile(const std::string &knownName);
     BmpFilePtr getBmpFile(uint32_t id);
@@ -74,16 +138,39 @@ public:
 
     std::string idType(uint32_t id);
 
+    //----------------------------------------------------------------------------
+    /// Copy of a wav file, followed by 32 zero bytes.
+    ///
+    /// @param id resource id
+    /// @return wav file or an empty pointer if not found
+    //
     std::shared_ptr<uint8_t> getWavPtr(uint32_t id);
 
+    //----------------------------------------------------------------------------
+    /// Get a wav file with its header parsed. Points into the file if it is
+    /// memory mapped instead of copying the sound, which also makes it safe
+    /// to call from several threads.
+    ///
+    /// @param id resource id
+    /// @return wav file, empty if not found
+    //
+    WavData getWav(uint32_t id);
+
     std::vector<uint32_t> binaryFileIds() const;
 
   std::vector<uint32_t> slpFileIds() const;
+    std::vector<uint32_t> wavFileIds() const;
 
 private:
     static Logger &log;
 
     bool header_loaded_ = false;
+    bool concurrent_ = false;
+
+    /// Tells the resources of this file apart in a shared cache.
+    const uint64_t archive_id_;
+
+    std::shared_ptr<ResourceCache> cache_;
 
     uint32_t num_of_tables_;
     uint32_t header_offset_;
@@ -93,12 +180,35 @@ private:
 
     std::unordered_map<uint32_t, std::shared_ptr<PalFile>> pal_files_;
 
+    /// Guards pal_files_ in concurrent mode. The other maps only change
+    /// while loading.
+    std::mutex cache_mutex_;
+
+    /// Makes sure each slp file is read once in concurrent mode.
+    std::unordered_map<uint32_t, std::once_flag> slp_loaded_;
+
     std::unordered_map<uint32_t, SlpFilePtr> slp_map_;
+    std::unordered_map<uint32_t, uint32_t> slp_sizes_;
     std::unordered_map<uint32_t, BinaFilePtr> bina_map_;
     std::unordered_map<uint32_t, uint32_t> wav_offsets_;
+    std::unordered_map<uint32_t, uint32_t> wav_sizes_;
 
     unsigned int getCopyRightHeaderSize(void) const;
 
+    //----------------------------------------------------------------------------
+    /// Stream to read a resource from, a new one over the mapped file in
+    /// concurrent mode, otherwise the stream of the file.
+    ///
+    /// @param own keeps the new stream alive
+    //
+    std::istream *resourceStream(std::unique_ptr<MemoryIStream> &own);
+
+    //----------------------------------------------------------------------------
+    /// Reads a new slp file or palette, for the resource cache.
+    //
+    SlpFilePtr readSlpFile(uint32_t id);
+    std::shared_ptr<PalFile> readPalFile(uint32_t id);
+
     std::string getSlpTableHeader(void) const;
     std::string getBinaryTableHeader(void) const;
     std::string getSoundTableHeader(void) const;
@@ -0,0 +1,175 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GENIE_DRSWRITER_H
+#define GENIE_DRSWRITER_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "genie/file/IFile.h"
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Builds drs files from resources held in memory.
+///
+/// load() reads all resources of an existing drs file, saveAs() writes a new
+/// one and append() adds resources to an existing file in place.
+///
+/// Payloads are written in access order if one is set, otherwise by table
+/// and id, and large ones start at page boundaries, so random access to a
+/// memory mapped archive touches as few pages as possible. Directory entries
+/// are always sorted by id.
+//
+class DrsWriter : public IFile
+{
+public:
+    /// Resource tables, in the order they are written.
+    enum Table : uint8_t {
+        BINARY = 0,
+        SLP,
+        WAV,
+        TABLE_COUNT
+    };
+
+    /// Table and id of a resource. Ids are unique within a table, different
+    /// tables may use the same id.
+    typedef std::pair<Table, uint32_t> ResourceKey;
+
+    //----------------------------------------------------------------------------
+    DrsWriter();
+    virtual ~DrsWriter();
+
+    //----------------------------------------------------------------------------
+    /// Adds a resource or replaces the one with the same table and id.
+    ///
+    /// @param table table to put the resource in
+    /// @param id resource id
+    /// @param data complete file, e. g. a slp or wav file
+    //
+    void setResource(Table table, uint32_t id, std::vector<char> data);
+
+    //----------------------------------------------------------------------------
+    /// @return false if there was no resource with the id in the table
+    //
+    bool removeResource(Table table, uint32_t id);
+
+    //----------------------------------------------------------------------------
+    bool hasResource(Table table, uint32_t id) const;
+
+    //----------------------------------------------------------------------------
+    /// @exception std::out_of_range if there is no resource with the id in
+    ///            the table
+    //
+    const std::vector<char> &getResource(Table table, uint32_t id) const;
+
+    //----------------------------------------------------------------------------
+    std::vector<uint32_t> resourceIds(Table table) const;
+
+    //----------------------------------------------------------------------------
+    /// Payloads of these resources are written first and in this order, e. g.
+    /// the order a game reads them in. Unknown resources are ignored.
+    //
+    void setAccessOrder(const std::vector<ResourceKey> &keys);
+
+    //----------------------------------------------------------------------------
+    /// Payloads of at least minSize bytes start at a multiple of alignment.
+    /// Defaults to 4096 byte pages for payloads of at least a page, use an
+    /// alignment of 1 to pack payloads without gaps.
+    //
+    void setAlignment(uint32_t alignment, uint32_t minSize);
+
+    //----------------------------------------------------------------------------
+    /// Adds the resources to an existing drs file without rewriting it.
+    ///
+    /// New payloads are written at the end of the file. Payloads of the
+    /// file which the grown directory would overwrite are moved to the end
+    /// too. Space of replaced resources isn't reused, save a loaded copy to
+    /// reclaim it.
+    ///
+    /// @exception std::ios_base::failure if the file can't be read or written
+    //
+    void append(const char *fileName);
+
+private:
+    /// Resource as listed in the directory of a file.
+    struct Entry {
+        Table table;
+        uint32_t id;
+        uint32_t pos;
+        uint32_t size;
+    };
+
+    std::string copyright_;
+    std::string version_;
+    std::string file_type_;
+
+    std::map<ResourceKey, std::vector<char>> resources_;
+    std::vector<ResourceKey> access_order_;
+
+    uint32_t alignment_ = 4096;
+    uint32_t align_min_size_ = 4096;
+
+    //----------------------------------------------------------------------------
+    size_t getCopyRightHeaderSize(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Size of the header and directory of a file with these entries.
+    //
+    uint32_t directorySize(const std::vector<Entry> &entries) const;
+
+    //----------------------------------------------------------------------------
+    /// Resources in the order their payloads are written.
+    //
+    std::vector<ResourceKey> payloadOrder(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Position of a payload written at end or later, aligned if it is large.
+    ///
+    /// @exception std::ios_base::failure if it doesn't fit into 4 GiB
+    //
+    uint64_t placePayload(uint64_t end, size_t size) const;
+
+    //----------------------------------------------------------------------------
+    /// Writes a payload to the stream, which is at position end.
+    ///
+    /// @return position of the payload
+    //
+    uint32_t writePayload(uint64_t &end, const std::vector<char> &data);
+
+    //----------------------------------------------------------------------------
+    /// Reads header and directory from the stream.
+    //
+    std::vector<Entry> readDirectory(void);
+
+    //----------------------------------------------------------------------------
+    /// Writes header and directory to the stream.
+    //
+    void writeDirectory(std::vector<Entry> entries);
+
+    virtual void unload(void);
+    virtual void serializeObject(void);
+};
+}
+
+#endif // GENIE_DRSWRITER_H
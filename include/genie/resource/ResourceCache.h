@@ -0,0 +1,180 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GENIE_RESOURCECACHE_H
+#define GENIE_RESOURCECACHE_H
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+
+#include "SlpFile.h"
+#include "PalFile.h"
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Keeps recently used resources of one or more archives in memory, up to a
+/// budget of bytes.
+///
+/// When the cache grows over the budget, the least recently used resources
+/// are dropped. Resources still referenced outside the cache are pinned and
+/// stay. Share one cache between DrsFiles with DrsFile::setResourceCache() to
+/// bound the memory of all of them. Thread safe.
+//
+class ResourceCache
+{
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+
+        /// Number of cached resources.
+        size_t entries = 0;
+
+        /// Memory held by the cached resources when they were last measured,
+        /// on insertion or by trim().
+        size_t bytes = 0;
+    };
+
+    //----------------------------------------------------------------------------
+    /// @param budget bytes to keep at most, apart from pinned resources
+    //
+    ResourceCache(size_t budget);
+    virtual ~ResourceCache();
+
+    ResourceCache(const ResourceCache &) = delete;
+    ResourceCache &operator=(const ResourceCache &) = delete;
+
+    //----------------------------------------------------------------------------
+    /// Sets the budget, dropping resources if it's lower than the cache size.
+    //
+    void setBudget(size_t budget);
+    size_t getBudget(void) const;
+
+    //----------------------------------------------------------------------------
+    Stats getStats(void) const;
+
+    //----------------------------------------------------------------------------
+    /// Returns a cached slp file or loads it.
+    ///
+    /// @param archive id of the archive, see newArchiveId()
+    /// @param id resource id
+    /// @param load called on a miss, may return an empty pointer
+    //
+    SlpFilePtr getSlpFile(uint64_t archive, uint32_t id,
+                          const std::function<SlpFilePtr()> &load);
+
+    //----------------------------------------------------------------------------
+    /// Returns a cached palette or loads it, like getSlpFile().
+    //
+    std::shared_ptr<PalFile> getPalFile(uint64_t archive, uint32_t id,
+                                        const std::function<std::shared_ptr<PalFile>()> &load);
+
+    //----------------------------------------------------------------------------
+    /// Measures all resources again, frames decoded since they were cached
+    /// are counted, and drops resources until the cache fits the budget.
+    //
+    void trim(void);
+
+    //----------------------------------------------------------------------------
+    /// Drops all resources that aren't pinned.
+    //
+    void clear(void);
+
+    //----------------------------------------------------------------------------
+    /// @return an id no other archive has, to tell resources apart
+    //
+    static uint64_t newArchiveId(void);
+
+private:
+    enum Type : uint8_t {
+        SLP = 0,
+        PAL
+    };
+
+    struct Key {
+        uint64_t archive;
+        uint32_t id;
+        Type type;
+
+        bool operator==(const Key &other) const
+        {
+            return archive == other.archive && id == other.id && type == other.type;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const
+        {
+            return std::hash<uint64_t>()(key.archive << 33 ^ uint64_t(key.id) << 1 ^ key.type);
+        }
+    };
+
+    struct Entry {
+        SlpFilePtr slp;
+        std::shared_ptr<PalFile> pal;
+        size_t bytes = 0;
+
+        /// Position in lru_.
+        std::list<Key>::iterator use;
+    };
+
+    size_t budget_;
+    Stats stats_;
+
+    /// Most recently used first.
+    std::list<Key> lru_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+
+    mutable std::mutex mutex_;
+
+    //----------------------------------------------------------------------------
+    /// Finds an entry and moves it to the front, counting a hit or miss.
+    /// Doesn't evict, the caller does so after taking its pointer.
+    //
+    Entry *find(const Key &key);
+
+    //----------------------------------------------------------------------------
+    /// Adds an entry unless another thread added it first.
+    ///
+    /// @param bytes size of the resource, measured without the lock
+    //
+    Entry &insert(const Key &key, SlpFilePtr slp, std::shared_ptr<PalFile> pal,
+                  size_t bytes);
+
+    //----------------------------------------------------------------------------
+    /// @return bytes held by a resource. Locks slp files, so it's called
+    ///         without holding mutex_.
+    //
+    static size_t measure(const SlpFilePtr &slp,
+                          const std::shared_ptr<PalFile> &pal);
+
+    //----------------------------------------------------------------------------
+    /// Drops least recently used entries until the cache fits the budget.
+    //
+    void evict(bool all = false);
+};
+}
+
+#endif // GENIE_RESOURCECACHE_H
@@ -24,6 +24,7 @@
 #include <vector>
 #include <sstream>
 #include <map>
+#include <mutex>
 
 #include "genie/file/IFile.h"
 #include "genie/util/Logger.h"
@@ -61,6 +62,13 @@ public:
     //
     bool isLoaded(void) const;
 
+    //----------------------------------------------------------------------------
+    /// Bytes of heap memory held by the file: copied file data, frame headers
+    /// and decoded images. Data pointing into a memory mapped archive isn't
+    /// counted.
+    //
+    size_t getMemoryUsage(void);
+
     //----------------------------------------------------------------------------
     /// Return number of frames stored in the file. Available after load.
     ///
@@ -70,7 +78,9 @@ public:
     void setFrameCount(uint32_t);
 
     //----------------------------------------------------------------------------
-    /// Returns the slp frame at given frame index.
+    /// Returns the slp frame at given frame index. The image of a frame is
+    /// decoded on first access, several threads can get frames of a loaded
+    /// file at once.
     ///
     /// @param frame frame index
     /// @return SlpFrame
@@ -82,8 +92,15 @@ public:
     std::string version;
     std::string comment;
 
+    //----------------------------------------------------------------------------
+    /// Raw data of the slp file. Empty if the file data points into a memory
+    /// mapped archive, use fileDataPtr() and fileDataSize() to cover both cases.
+    //
     const std::vector<uint8_t> &fileData() const { return m_graphicsFileData; }
 
+    const uint8_t *fileDataPtr() const { return m_fileData; }
+    size_t fileDataSize() const { return m_fileDataSize; }
+
     int frameCommandsOffset(const size_t frame, const int row);
     int frameHeight(const size_t frame);
     int frameWidth(const size_t frame);
@@ -104,6 +121,9 @@ private:
     // Used to calculate offsets when saving the SLP.
     uint32_t slp_offset_;
 
+    /// Guards decoding frame images in getFrame().
+    std::mutex frame_mutex_;
+
     //----------------------------------------------------------------------------
     virtual void serializeObject(void);
 
@@ -113,10 +133,29 @@ private:
     void loadFile(void);
     void saveFile(void);
 
+    //----------------------------------------------------------------------------
+    /// Loads the file again from its file data after it was unloaded.
+    ///
+    /// @exception std::logic_error if the file was never loaded
+    //
+    void reload(void);
+
     //----------------------------------------------------------------------------
     void serializeHeader(void);
 
+    //----------------------------------------------------------------------------
+    /// Points the file data at the memory block the slp is read from if
+    /// possible, otherwise copies it from the stream.
+    //
+    void loadFileData(void);
+
     std::vector<uint8_t> m_graphicsFileData;
+
+    // Either m_graphicsFileData or a range in a memory mapped file
+    const uint8_t *m_fileData = nullptr;
+    size_t m_fileDataSize = 0;
+    std::shared_ptr<const void> m_fileDataOwner;
+
 //    static std::map<std::string, std::string> m_graphicsFileData;
 //    static std::map<std::string, std::string> m_graphicsFileData;
 //    std::string m_graphicsFileData;
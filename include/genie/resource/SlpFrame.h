@@ -137,6 +137,12 @@ public:
     //
     void serializeHeader(void);
     void setLoadParams(std::istream &istr);
+
+    //----------------------------------------------------------------------------
+    /// Forgets the stream given to setLoadParams() or load().
+    //
+    void resetLoadParams(void);
+
     void setSaveParams(std::ostream &ostr, uint32_t &slp_offset_);
 
     //----------------------------------------------------------------------------
@@ -156,6 +162,11 @@ public:
     //
     uint32_t getHeight(void) const;
 
+    //----------------------------------------------------------------------------
+    /// Bytes of heap memory held by the frame, mostly the decoded image.
+    //
+    size_t getMemoryUsage(void) const;
+
     void setSize(const uint32_t width, const uint32_t height);
     void enlarge(const uint32_t width, const uint32_t height, const int32_t offset_x, const int32_t offset_y);
     void enlargeForMerge(const SlpFrame &frame, int32_t &os_x, int32_t &os_y);
@@ -0,0 +1,63 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GENIE_WAVDATA_H
+#define GENIE_WAVDATA_H
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// A wav file stored in a drs file. Points into the archive if it is memory
+/// mapped, otherwise holds a copy of the file.
+//
+struct WavData {
+    /// The complete RIFF file, the pointer keeps it alive.
+    std::shared_ptr<const uint8_t> data;
+    size_t size = 0;
+
+    /// Fields of the fmt chunk, format 1 is PCM.
+    uint16_t format = 0;
+    uint16_t channels = 0;
+    uint32_t sample_rate = 0;
+    uint16_t bits_per_sample = 0;
+
+    /// Contents of the data chunk, points into data.
+    const uint8_t *samples = nullptr;
+    size_t samples_size = 0;
+
+    //----------------------------------------------------------------------------
+    inline bool empty(void) const
+    {
+        return !data;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Reads the fmt and data chunks of data.
+    ///
+    /// @return false if data isn't a wav file
+    //
+    bool parse(void);
+};
+}
+
+#endif // GENIE_WAVDATA_H
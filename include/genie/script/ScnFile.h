@@ -47,6 +47,12 @@ public:
     };
     BlnFile();
 
+    //----------------------------------------------------------------------------
+    /// Sets how strongly the file is compressed when saving, see
+    /// Compressor::CompressionProfile.
+    //
+    void setCompressionProfile(Compressor::CompressionProfile profile);
+
     float version = 0.f;
     std::array<Frame, 20> frames;
 
@@ -80,11 +86,31 @@ public:
 
     //----------------------------------------------------------------------------
     /// Extracts a scenario (for debugging purpose).
+    ///
+    /// @return number of uncompressed bytes written
     //
-    void extractRaw(const char *from, const char *to);
+    size_t extractRaw(const char *from, const char *to);
 
     static uint32_t getSeparator(void);
 
+    //----------------------------------------------------------------------------
+    /// Sets how the compressed part of the scenario is inflated while loading.
+    //
+    void setDecompressionMode(Compressor::DecompressionMode mode);
+
+    //----------------------------------------------------------------------------
+    /// Sets the library used for in-memory (de)compression.
+    ///
+    /// @return false if the backend isn't compiled in
+    //
+    bool setCompressionBackend(CompressionBackend::Type type);
+
+    //----------------------------------------------------------------------------
+    /// Sets how strongly the file is compressed when saving, see
+    /// Compressor::CompressionProfile.
+    //
+    void setCompressionProfile(Compressor::CompressionProfile profile);
+
     std::string version;
 
     // Uncompressed Header:
@@ -47,8 +47,6 @@ public:
     uint32_t ore;
     uint32_t goods;
 
-    static bool playerInfo;
-
 private:
     virtual void serializeObject(void);
 };
@@ -19,6 +19,7 @@
 */
 
 #include "genie/dat/Civ.h"
+#include "genie/dat/UnitPool.h"
 
 namespace genie {
 
@@ -35,6 +36,71 @@ void Civ::setGameVersion(GameVersion gv)
     ISerializable::setGameVersion(gv);
 
     updateGameVersion(Units);
+
+    for (std::shared_ptr<Unit> &unit : sharedUnits_)
+        unit->setGameVersion(gv);
+}
+
+void Civ::shareUnits(UnitPool &pool)
+{
+    sharedUnits_.clear();
+    sharedUnits_.reserve(Units.size());
+
+    std::shared_ptr<Unit> empty;
+
+    for (size_t i = 0; i < Units.size(); ++i) {
+        if (i < UnitPointers.size() && UnitPointers[i]) {
+            sharedUnits_.push_back(pool.intern(Units[i]));
+        } else {
+            // Never written, no need to compare them.
+            if (!empty)
+                empty = std::make_shared<Unit>(std::move(Units[i]));
+            sharedUnits_.push_back(empty);
+        }
+    }
+
+    std::vector<Unit>().swap(Units);
+}
+
+void Civ::unshareUnits(void)
+{
+    if (!hasSharedUnits())
+        return;
+
+    Units.reserve(sharedUnits_.size());
+
+    for (const std::shared_ptr<Unit> &unit : sharedUnits_)
+        Units.push_back(*unit);
+
+    sharedUnits_.clear();
+}
+
+bool Civ::hasSharedUnits(void) const
+{
+    return !sharedUnits_.empty();
+}
+
+size_t Civ::getUnitCount(void) const
+{
+    return hasSharedUnits() ? sharedUnits_.size() : Units.size();
+}
+
+const Unit &Civ::getUnit(size_t id) const
+{
+    return hasSharedUnits() ? *sharedUnits_[id] : Units[id];
+}
+
+Unit &Civ::editUnit(size_t id)
+{
+    if (!hasSharedUnits())
+        return Units[id];
+
+    std::shared_ptr<Unit> &unit = sharedUnits_[id];
+
+    if (unit.use_count() > 1)
+        unit = std::make_shared<Unit>(*unit);
+
+    return *unit;
 }
 
 unsigned short Civ::getNameSize(void)
@@ -74,8 +140,19 @@ void Civ::serializeObject(void)
 
     serialize<int8_t>(IconSet);
 
-    serializeSize<uint16_t>(count, Units.size());
+    serializeSize<uint16_t>(count, getUnitCount());
     serialize<int32_t>(UnitPointers, count);
-    serializeSubWithPointers<Unit>(Units, count, UnitPointers);
+
+    if (isOperation(OP_READ)) {
+        sharedUnits_.clear();
+        serializeSubWithPointers<Unit>(Units, count, UnitPointers);
+
+        if (context().unit_pool)
+            shareUnits(*context().unit_pool);
+    } else if (hasSharedUnits()) {
+        serializeSubWithPointers<Unit>(sharedUnits_, count, UnitPointers);
+    } else {
+        serializeSubWithPointers<Unit>(Units, count, UnitPointers);
+    }
 }
 }
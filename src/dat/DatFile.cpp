@@ -19,17 +19,58 @@
 */
 
 #include "genie/dat/DatFile.h"
+#include "genie/dat/DatFingerprint.h"
+#include "genie/dat/UnitPool.h"
+#include "genie/file/MappedFile.h"
+#include "genie/util/Hash.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <mutex>
+#include <string.h>
+#include <thread>
 #include <vector>
 
 #include "genie/Types.h"
 
 namespace genie {
 
-float ISerializable::dat_internal_ver = 0.f;
 GameVersion GV_LatestTap = GV_T8;
 
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'G', 'E', 'N', 'I', 'E', 'S', 'N', 'P' };
+
+/// Increase when the layout of the snapshot or of the kept data changes.
+const uint32_t SNAPSHOT_FORMAT = 3;
+
+const uint64_t SNAPSHOT_NO_OFFSET = uint64_t(-1);
+
+//------------------------------------------------------------------------------
+/// Start of a snapshot file, followed by the uncompressed file data and
+/// civOffsetCount civ offsets. Stored in native byte order, snapshots are
+/// only valid on the machine type that wrote them.
+//
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t format;
+    int32_t gameVersion;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t bodySize;
+    uint64_t civOffsetCount;
+
+    /// XxHash64 of the uncompressed file data, to reject damaged snapshots.
+    uint64_t bodyHash;
+
+    /// Relative to the data, SNAPSHOT_NO_OFFSET where unknown.
+    uint64_t sectionOffsets[DatFile::SECTION_COUNT + 1];
+};
+}
+
 //------------------------------------------------------------------------------
 DatFile::DatFile() :
     compressor_(this)
@@ -45,6 +86,15 @@ DatFile::~DatFile()
 //------------------------------------------------------------------------------
 void DatFile::setGameVersion(GameVersion gv)
 {
+    if (gv != getGameVersion()) {
+        // Sections not loaded yet can only be read with the old version.
+        if (rawBody_ && !sectionLoaded_.empty())
+            loadAllSections();
+
+        // Kept data was written for the old version.
+        sectionDirty_.assign(sectionDirty_.size(), true);
+    }
+
     ISerializable::setGameVersion(gv);
 
     updateGameVersion(TerrainRestrictions);
@@ -56,13 +106,20 @@ void DatFile::setGameVersion(GameVersion gv)
     updateGameVersion(UnitHeaders);
     updateGameVersion(Civs);
     updateGameVersion(Techs);
-    TerrainBlock.setGameVersion(gv);
+    TerrainBlock.setGameVersion(gv, terrainCount_ ? terrainCount_ : Terrain::getTerrainCount(gv));
     RandomMaps.setGameVersion(gv);
     TechTree.setGameVersion(gv);
 }
 
 //------------------------------------------------------------------------------
-void DatFile::extractRaw(const char *inFile, const char *outFile)
+void DatFile::setTerrainCount(unsigned short cnt)
+{
+    terrainCount_ = cnt;
+    context().terrain_count = cnt;
+}
+
+//------------------------------------------------------------------------------
+size_t DatFile::extractRaw(const char *inFile, const char *outFile)
 {
     std::ifstream ifs;
     std::ofstream ofs;
@@ -70,10 +127,12 @@ void DatFile::extractRaw(const char *inFile, const char *outFile)
     ifs.open(inFile, std::ios::binary);
     ofs.open(outFile, std::ios::binary);
 
-    Compressor::decompress(ifs, ofs);
+    size_t size = Compressor::decompress(ifs, ofs);
 
     ifs.close();
     ofs.close();
+
+    return size;
 }
 
 //------------------------------------------------------------------------------
@@ -82,11 +141,757 @@ void DatFile::setVerboseMode(bool verbose)
     verbose_ = verbose;
 }
 
+//------------------------------------------------------------------------------
+void DatFile::setLazyLoading(bool lazy)
+{
+    lazyLoading_ = lazy;
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::isLazyLoading(void) const
+{
+    return lazyLoading_;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::setIncrementalSaving(bool incremental)
+{
+    incrementalSaving_ = incremental;
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::isIncrementalSaving(void) const
+{
+    return incrementalSaving_;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::markDirty(Section section)
+{
+    if (size_t(section) < sectionDirty_.size())
+        sectionDirty_[section] = true;
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::isSectionDirty(Section section) const
+{
+    return isSectionLoaded(section) && !isSectionRaw(section);
+}
+
+//------------------------------------------------------------------------------
+void DatFile::setSnapshotFile(const std::string &fileName)
+{
+    snapshotFile_ = fileName;
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::isLoadedFromSnapshot(void) const
+{
+    return loadedFromSnapshot_;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::setUnitSharing(bool share)
+{
+    unitSharing_ = share;
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::isUnitSharing(void) const
+{
+    return unitSharing_;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::setDecompressionMode(Compressor::DecompressionMode mode)
+{
+    compressor_.setDecompressionMode(mode);
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::setCompressionBackend(CompressionBackend::Type type)
+{
+    return compressor_.setCompressionBackend(type);
+}
+
+//------------------------------------------------------------------------------
+void DatFile::setCompressionProfile(Compressor::CompressionProfile profile)
+{
+    compressor_.setCompressionProfile(profile);
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::isSectionLoaded(Section section) const
+{
+    return !rawBody_ || sectionLoaded_[section];
+}
+
+//------------------------------------------------------------------------------
+void DatFile::loadSection(Section section)
+{
+    if (isSectionLoaded(section))
+        return;
+
+    // Start at the closest section with a known offset. Sections in between
+    // are read only to find where the next one starts.
+    int first = section;
+    while (sectionOffsets_[first] == NO_OFFSET)
+        --first;
+
+    setOperation(OP_READ);
+    setIStream(*rawBody_);
+
+    for (int i = first; i <= section; ++i) {
+        rawBody_->seekg(sectionOffsets_[i]);
+
+        serializeSection(Section(i));
+
+        sectionOffsets_[i + 1] = rawBody_->buffer()->position();
+
+        if (i != section)
+            clearSection(Section(i));
+    }
+
+    sectionLoaded_[section] = true;
+
+    if (incrementalSaving_)
+        sectionHashes_[section] = hashSection(section);
+}
+
+//------------------------------------------------------------------------------
+void DatFile::loadAllSections(void)
+{
+    if (loadThreads_ != 1 && canLoadInParallel()) {
+        loadSectionsInParallel();
+        return;
+    }
+
+    for (int i = 0; i < SECTION_COUNT; ++i)
+        loadSection(Section(i));
+}
+
+//------------------------------------------------------------------------------
+void DatFile::setLoadThreads(unsigned threads)
+{
+    loadThreads_ = threads;
+}
+
+//------------------------------------------------------------------------------
+unsigned DatFile::getLoadThreads(void) const
+{
+    return loadThreads_;
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::canLoadInParallel(void) const
+{
+    if (!rawBody_)
+        return false;
+
+    for (size_t offset : sectionOffsets_) {
+        if (offset == NO_OFFSET)
+            return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::loadSectionsInParallel(void)
+{
+    const char *body = rawBody_->buffer()->data();
+    GameVersion gv = getGameVersion();
+
+    // Every task reads from its own stream, the readers only provide the
+    // context and hold the sections they read until they are moved here.
+    typedef std::function<void(DatFile &reader)> Task;
+
+    std::vector<Task> tasks;
+    std::vector<DatFile *> sectionReaders(SECTION_COUNT, nullptr);
+
+    bool civByCiv = false;
+
+    if (!sectionLoaded_[SECTION_CIVS] && civOffsets_.size() > 1) {
+        uint16_t count;
+
+        setOperation(OP_READ);
+        setIStream(*rawBody_);
+        rawBody_->seekg(sectionOffsets_[SECTION_CIVS]);
+        serializeSize<uint16_t>(count, Civs.size());
+
+        if (count == civOffsets_.size() - 1) {
+            civByCiv = true;
+
+            rawBody_->seekg(civOffsets_.back());
+            if (gv >= GV_SWGB)
+                serialize<int8_t>(SUnknown7);
+
+            Civs.clear();
+            Civs.resize(count);
+
+            for (size_t i = 0; i < count; ++i) {
+                tasks.push_back([this, body, i](DatFile &reader) {
+                    MemoryIStream in(body + civOffsets_[i], civOffsets_[i + 1] - civOffsets_[i]);
+
+                    reader.setIStream(in);
+                    Civs[i].serializeSubObject(&reader);
+                });
+            }
+        }
+    }
+
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        if (sectionLoaded_[i] || (i == SECTION_CIVS && civByCiv))
+            continue;
+
+        tasks.push_back([this, body, i, &sectionReaders](DatFile &reader) {
+            MemoryIStream in(body + sectionOffsets_[i], sectionOffsets_[i + 1] - sectionOffsets_[i]);
+
+            reader.setIStream(in);
+            reader.serializeSection(Section(i));
+            sectionReaders[i] = &reader;
+        });
+    }
+
+    unsigned threadCount = loadThreads_ ? loadThreads_ : std::thread::hardware_concurrency();
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, tasks.size()));
+
+    // Units are shared afterwards, the pool can't be used from several threads.
+    SerializationContext readerContext = context();
+    readerContext.unit_pool = 0;
+
+    std::vector<std::unique_ptr<DatFile>> readers;
+
+    for (unsigned i = 0; i < threadCount; ++i) {
+        readers.push_back(std::make_unique<DatFile>());
+        readers[i]->setGameVersion(gv);
+        readers[i]->setOperation(OP_READ);
+        readers[i]->context() = readerContext;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&](DatFile &reader) {
+        for (size_t task = next++; task < tasks.size(); task = next++) {
+            try {
+                tasks[task](reader);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned i = 1; i < threadCount; ++i)
+        threads.emplace_back(work, std::ref(*readers[i]));
+
+    work(*readers[0]);
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        if (sectionReaders[i])
+            takeSection(*sectionReaders[i], Section(i));
+    }
+
+    if (unitSharing_ && !sectionLoaded_[SECTION_CIVS]) {
+        UnitPool pool;
+
+        for (Civ &civ : Civs)
+            civ.shareUnits(pool);
+    }
+
+    sectionLoaded_.assign(SECTION_COUNT, true);
+
+    if (incrementalSaving_) {
+        for (int i = 0; i < SECTION_COUNT; ++i)
+            sectionHashes_[i] = hashSection(Section(i));
+    }
+}
+
+//------------------------------------------------------------------------------
+void DatFile::takeSection(DatFile &from, Section section)
+{
+    switch (section) {
+    case SECTION_PLAYER_COLOURS:
+        PlayerColours.swap(from.PlayerColours);
+        break;
+    case SECTION_SOUNDS:
+        Sounds.swap(from.Sounds);
+        break;
+    case SECTION_GRAPHICS:
+        GraphicPointers.swap(from.GraphicPointers);
+        Graphics.swap(from.Graphics);
+        break;
+    case SECTION_TERRAIN_BLOCK:
+        TerrainBlock = from.TerrainBlock;
+        break;
+    case SECTION_RANDOM_MAPS:
+        RandomMaps = from.RandomMaps;
+        break;
+    case SECTION_EFFECTS:
+        Effects.swap(from.Effects);
+        break;
+    case SECTION_UNIT_LINES:
+        UnitLines.swap(from.UnitLines);
+        break;
+    case SECTION_UNIT_HEADERS:
+        UnitHeaders.swap(from.UnitHeaders);
+        break;
+    case SECTION_CIVS:
+        Civs.swap(from.Civs);
+        SUnknown7 = from.SUnknown7;
+        break;
+    case SECTION_TECHS:
+        Techs.swap(from.Techs);
+        SUnknown8 = from.SUnknown8;
+        break;
+    case SECTION_TECH_TREE:
+        TimeSlice = from.TimeSlice;
+        UnitKillRate = from.UnitKillRate;
+        UnitKillTotal = from.UnitKillTotal;
+        UnitHitPointRate = from.UnitHitPointRate;
+        UnitHitPointTotal = from.UnitHitPointTotal;
+        RazingKillRate = from.RazingKillRate;
+        RazingKillTotal = from.RazingKillTotal;
+        TechTree = from.TechTree;
+        break;
+    default:
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+void DatFile::readCivs(uint16_t count)
+{
+    UnitPool pool;
+
+    if (unitSharing_)
+        context().unit_pool = &pool;
+
+    // Noted so the civs can be read in parallel from a snapshot.
+    const MemoryReadBuffer *in = rawBody_ && getIBuffer() == rawBody_->buffer() ? getIBuffer() : 0;
+
+    civOffsets_.clear();
+    Civs.resize(count);
+
+    try {
+        for (Civ &civ : Civs) {
+            if (in)
+                civOffsets_.push_back(in->position());
+
+            civ.serializeSubObject(this);
+        }
+    } catch (...) {
+        context().unit_pool = 0;
+        throw;
+    }
+
+    if (in)
+        civOffsets_.push_back(in->position());
+
+    context().unit_pool = 0;
+
+    if (verbose_ && unitSharing_)
+        std::cout << "Different units: " << pool.size() << std::endl;
+}
+
 //------------------------------------------------------------------------------
 void DatFile::serializeObject(void)
 {
+    // The header may change the version, sections of the last load must not
+    // be loaded for it.
+    if (isOperation(OP_READ))
+        releaseRawBody();
+
+    if (isOperation(OP_READ) && !snapshotFile_.empty()) {
+        readWithSnapshot();
+        return;
+    }
+
     compressor_.beginCompression();
 
+    if (isOperation(OP_READ) && (lazyLoading_ || incrementalSaving_)) {
+        readRawBody();
+
+        if (!lazyLoading_)
+            loadAllSections();
+    } else {
+        // Where the sections start in the written data, to keep it for the
+        // next incremental save.
+        MemoryWriteBuffer *out = isOperation(OP_WRITE) && incrementalSaving_ ? getOBuffer() : 0;
+        size_t body = out ? out->size() : 0;
+        std::vector<size_t> offsets(SECTION_COUNT + 1, NO_OFFSET);
+
+        if (incrementalSaving_ && rawBody_)
+            markChangedSections();
+
+        serializeHeader();
+
+        for (int i = 0; i < SECTION_COUNT; ++i) {
+            if (isSectionRaw(Section(i))) {
+                i = serializeRawSections(Section(i), out ? &offsets : 0, body);
+            } else {
+                if (out)
+                    offsets[i] = out->size() - body;
+
+                serializeSection(Section(i));
+            }
+        }
+
+        if (out)
+            keepRawBody(out, body, offsets);
+    }
+
+    compressor_.endCompression();
+}
+
+//------------------------------------------------------------------------------
+void DatFile::readRawBody(void)
+{
+    MemoryReadBuffer *in = getIBuffer();
+
+    if (in && in->owner()) {
+        // Already inflated into memory, share it.
+        rawBody_ = std::make_unique<MemoryIStream>(in->data() + in->position(),
+                                                   in->size() - in->position());
+        rawBody_->buffer()->setOwner(in->owner());
+    } else {
+        std::shared_ptr<std::vector<char>> body = std::make_shared<std::vector<char>>();
+        std::istream *istr = getIStream();
+        char buffer[1 << 16];
+
+        while (istr->read(buffer, sizeof(buffer)) || istr->gcount() > 0)
+            body->insert(body->end(), buffer, buffer + istr->gcount());
+
+        rawBody_ = std::make_unique<MemoryIStream>(body->data(), body->size());
+        rawBody_->buffer()->setOwner(body);
+    }
+
+    setIStream(*rawBody_);
+    serializeHeader();
+
+    sectionOffsets_.assign(SECTION_COUNT + 1, NO_OFFSET);
+    sectionOffsets_[0] = rawBody_->buffer()->position();
+    sectionOffsets_[SECTION_COUNT] = rawBody_->buffer()->size();
+    sectionLoaded_.assign(SECTION_COUNT, false);
+    sectionDirty_.assign(SECTION_COUNT, false);
+    sectionHashes_.assign(SECTION_COUNT, 0);
+    civOffsets_.clear();
+}
+
+//------------------------------------------------------------------------------
+void DatFile::releaseRawBody(void)
+{
+    rawBody_.reset();
+    sectionOffsets_.clear();
+    sectionLoaded_.clear();
+    sectionDirty_.clear();
+    sectionHashes_.clear();
+    civOffsets_.clear();
+}
+
+//------------------------------------------------------------------------------
+void DatFile::readWithSnapshot(void)
+{
+    GameVersion gv = getGameVersion();
+    std::istream *source = getIStream();
+
+    // The compressed data is needed in memory to hash it.
+    std::vector<char> storage;
+    const char *data;
+    size_t size;
+
+    if (const MemoryReadBuffer *in = getIBuffer()) {
+        data = in->data() + in->position();
+        size = in->size() - in->position();
+    } else {
+        char buffer[1 << 16];
+
+        while (source->read(buffer, sizeof(buffer)) || source->gcount() > 0)
+            storage.insert(storage.end(), buffer, buffer + source->gcount());
+
+        data = storage.data();
+        size = storage.size();
+    }
+
+    uint64_t hash = Hash64::of(data, size);
+
+    loadedFromSnapshot_ = readSnapshot(hash, size, gv);
+
+    if (!loadedFromSnapshot_) {
+        MemoryIStream compressed(data, size);
+        setIStream(compressed);
+
+        compressor_.beginCompression();
+        readRawBody();
+
+        if (!lazyLoading_)
+            loadAllSections();
+
+        compressor_.endCompression();
+        setIStream(*source);
+
+        writeSnapshot(hash, size, gv);
+    }
+
+    // Without a use for the data don't keep it around.
+    if (!lazyLoading_ && !incrementalSaving_)
+        releaseRawBody();
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::readSnapshot(uint64_t sourceHash, uint64_t sourceSize, GameVersion gv)
+{
+    std::shared_ptr<MappedFile> mapping;
+
+    try {
+        mapping = std::make_shared<MappedFile>(snapshotFile_);
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    SnapshotHeader header;
+
+    if (mapping->size() < sizeof(header))
+        return false;
+
+    memcpy(&header, mapping->data(), sizeof(header));
+
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+        || header.format != SNAPSHOT_FORMAT
+        || header.gameVersion != gv
+        || header.sourceHash != sourceHash
+        || header.sourceSize != sourceSize
+        || header.bodySize > mapping->size() - sizeof(header)
+        || header.civOffsetCount != (mapping->size() - sizeof(header) - header.bodySize) / sizeof(uint64_t)
+        || (mapping->size() - sizeof(header) - header.bodySize) % sizeof(uint64_t) != 0
+        || header.sectionOffsets[SECTION_COUNT] != header.bodySize
+        || header.sectionOffsets[0] > header.bodySize) {
+        return false;
+    }
+
+    sectionOffsets_.assign(SECTION_COUNT + 1, NO_OFFSET);
+
+    // Sections are read from between known offsets, which have to be in
+    // order.
+    uint64_t previous = 0;
+
+    for (int i = 0; i <= SECTION_COUNT; ++i) {
+        uint64_t offset = header.sectionOffsets[i];
+
+        if (offset != SNAPSHOT_NO_OFFSET) {
+            if (offset < previous || offset > header.bodySize)
+                return false;
+
+            sectionOffsets_[i] = size_t(offset);
+            previous = offset;
+        }
+    }
+
+    const char *body = mapping->data() + sizeof(header);
+
+    if (XxHash64::of(body, size_t(header.bodySize)) != header.bodyHash)
+        return false;
+
+    std::vector<uint64_t> civOffsets(header.civOffsetCount);
+    memcpy(civOffsets.data(), mapping->data() + sizeof(header) + header.bodySize,
+           civOffsets.size() * sizeof(uint64_t));
+
+    // Civs are read from between their offsets, which have to be in order
+    // and inside the civ section.
+    if (!civOffsets.empty()) {
+        uint64_t begin = header.sectionOffsets[SECTION_CIVS];
+        uint64_t end = header.sectionOffsets[SECTION_CIVS + 1];
+
+        if (begin == SNAPSHOT_NO_OFFSET || end == SNAPSHOT_NO_OFFSET)
+            return false;
+
+        uint64_t previous = begin;
+
+        for (uint64_t offset : civOffsets) {
+            if (offset < previous || offset > end)
+                return false;
+
+            previous = offset;
+        }
+    }
+
+    rawBody_ = std::make_unique<MemoryIStream>(body, size_t(header.bodySize));
+    rawBody_->buffer()->setOwner(mapping);
+
+    setIStream(*rawBody_);
+    serializeHeader();
+
+    sectionLoaded_.assign(SECTION_COUNT, false);
+    sectionDirty_.assign(SECTION_COUNT, false);
+    sectionHashes_.assign(SECTION_COUNT, 0);
+    civOffsets_.assign(civOffsets.begin(), civOffsets.end());
+
+    if (!lazyLoading_)
+        loadAllSections();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::writeSnapshot(uint64_t sourceHash, uint64_t sourceSize, GameVersion gv)
+{
+    const MemoryReadBuffer *body = rawBody_->buffer();
+    SnapshotHeader header;
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.format = SNAPSHOT_FORMAT;
+    header.gameVersion = gv;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.bodySize = body->size();
+    header.civOffsetCount = civOffsets_.size();
+    header.bodyHash = XxHash64::of(body->data(), body->size());
+
+    for (int i = 0; i <= SECTION_COUNT; ++i) {
+        header.sectionOffsets[i] = sectionOffsets_[i] == NO_OFFSET ? SNAPSHOT_NO_OFFSET
+                                                                   : sectionOffsets_[i];
+    }
+
+    std::vector<uint64_t> civOffsets(civOffsets_.begin(), civOffsets_.end());
+    std::vector<char> data(sizeof(header) + body->size() + civOffsets.size() * sizeof(uint64_t));
+
+    memcpy(data.data(), &header, sizeof(header));
+    memcpy(data.data() + sizeof(header), body->data(), body->size());
+    memcpy(data.data() + sizeof(header) + body->size(), civOffsets.data(),
+           civOffsets.size() * sizeof(uint64_t));
+
+    // The snapshot only saves time, loading works without it.
+    try {
+        writeFile(snapshotFile_.c_str(), data.data(), data.size());
+    } catch (const std::exception &exception) {
+        std::cerr << "Can't write snapshot: " << exception.what() << std::endl;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool DatFile::isSectionRaw(Section section) const
+{
+    if (!rawBody_)
+        return false;
+
+    return !sectionLoaded_[section] || (incrementalSaving_ && !sectionDirty_[section]);
+}
+
+//------------------------------------------------------------------------------
+int DatFile::serializeRawSections(Section section, std::vector<size_t> *offsets,
+                                  size_t body)
+{
+    // Sections before a raw one are either raw too or loaded, so its start is
+    // known. It ends where the next serialized section starts, which is
+    // loaded and so has a known start too.
+    int next = section + 1;
+    while (next < SECTION_COUNT && isSectionRaw(Section(next)))
+        ++next;
+
+    size_t begin = sectionOffsets_[section];
+
+    if (offsets) {
+        size_t start = getOBuffer()->size() - body;
+
+        for (int i = section; i < next; ++i) {
+            if (sectionOffsets_[i] != NO_OFFSET)
+                (*offsets)[i] = start + sectionOffsets_[i] - begin;
+        }
+    }
+
+    char *data = const_cast<char *>(rawBody_->buffer()->data() + begin);
+
+    serialize<char>(&data, sectionOffsets_[next] - begin);
+
+    return next - 1;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::keepRawBody(const MemoryWriteBuffer *out, size_t body,
+                          std::vector<size_t> &offsets)
+{
+    offsets[SECTION_COUNT] = out->size() - body;
+
+    std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>(
+        out->data() + body, out->data() + out->size());
+
+    rawBody_ = std::make_unique<MemoryIStream>(data->data(), data->size());
+    rawBody_->buffer()->setOwner(data);
+
+    sectionOffsets_.swap(offsets);
+    civOffsets_.clear();
+
+    if (sectionLoaded_.empty()) {
+        sectionLoaded_.assign(SECTION_COUNT, true);
+        sectionDirty_.assign(SECTION_COUNT, true);
+        sectionHashes_.assign(SECTION_COUNT, 0);
+    }
+
+    // Clean sections still have the hash they were checked with.
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        if (sectionLoaded_[i] && sectionDirty_[i])
+            sectionHashes_[i] = hashSection(Section(i));
+    }
+
+    sectionDirty_.assign(SECTION_COUNT, false);
+}
+
+//------------------------------------------------------------------------------
+uint64_t DatFile::hashSection(Section section)
+{
+    DatFingerprint fingerprint;
+    fingerprint.updateSection(*this, section);
+
+    uint64_t hash = fingerprint.getSectionHash(section);
+    GameVersion gv = getGameVersion();
+
+    switch (section) {
+    case SECTION_CIVS:
+        if (gv >= GV_SWGB)
+            hash = XxHash64::of(&SUnknown7, sizeof(SUnknown7), hash);
+        break;
+    case SECTION_TECHS:
+        if (gv >= GV_SWGB)
+            hash = XxHash64::of(&SUnknown8, sizeof(SUnknown8), hash);
+        break;
+    case SECTION_TECH_TREE:
+        if (gv >= GV_AoKA) {
+            int32_t history[] = { TimeSlice, UnitKillRate, UnitKillTotal,
+                                  UnitHitPointRate, UnitHitPointTotal,
+                                  RazingKillRate, RazingKillTotal };
+            hash = XxHash64::of(history, sizeof(history), hash);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+void DatFile::markChangedSections(void)
+{
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        if (sectionLoaded_[i] && !sectionDirty_[i] && hashSection(Section(i)) != sectionHashes_[i])
+            sectionDirty_[i] = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+void DatFile::serializeHeader(void)
+{
     serialize(FileVersion, FILE_VERSION_SIZE);
 
     // Handle all different versions while in development.
@@ -109,17 +914,16 @@ void DatFile::serializeObject(void)
 
     GameVersion gv = getGameVersion();
     uint16_t count16;
-    uint32_t count32;
 
     if (gv >= GV_SWGB) {
-        serializeSize<uint16_t>(count16, Civs.size());
+        serializeSize<uint16_t>(civCount_, isSectionLoaded(SECTION_CIVS) ? Civs.size() : civCount_);
         serialize<int32_t>(SUnknown2);
         serialize<int32_t>(SUnknown3);
         serialize<int32_t>(SUnknown4);
         serialize<int32_t>(SUnknown5);
 
         if (verbose_) {
-            std::cout << "Unkown1: " << count16 << std::endl;
+            std::cout << "Unkown1: " << civCount_ << std::endl;
             std::cout << "Unkown2: " << SUnknown2 << std::endl;
             std::cout << "Unkown3: " << SUnknown3 << std::endl;
             std::cout << "Unkown4: " << SUnknown4 << std::endl;
@@ -142,123 +946,195 @@ void DatFile::serializeObject(void)
     if (gv >= GV_AoKA)
         serialize<int32_t>(TerrainPassGraphicPointers, count16);
 
-    TerrainRestriction::setTerrainCount(TerrainsUsed1);
+    context().terrain_restriction_count = TerrainsUsed1;
     serializeSub<TerrainRestriction>(TerrainRestrictions, count16);
+}
 
-    serializeSize<uint16_t>(count16, PlayerColours.size());
+//------------------------------------------------------------------------------
+void DatFile::serializeSection(Section section)
+{
+    GameVersion gv = getGameVersion();
+    uint16_t count16;
+    uint32_t count32;
 
-    if (verbose_)
-        std::cout << "PlayerColours: " << count16 << std::endl;
+    switch (section) {
+    case SECTION_PLAYER_COLOURS:
+        serializeSize<uint16_t>(count16, PlayerColours.size());
 
-    serializeSub<PlayerColour>(PlayerColours, count16);
+        if (verbose_)
+            std::cout << "PlayerColours: " << count16 << std::endl;
 
-    serializeSize<uint16_t>(count16, Sounds.size());
+        serializeSub<PlayerColour>(PlayerColours, count16);
+        break;
 
-    if (verbose_)
-        std::cout << "Sounds: " << count16 << std::endl;
+    case SECTION_SOUNDS:
+        serializeSize<uint16_t>(count16, Sounds.size());
 
-    serializeSub<Sound>(Sounds, count16);
+        if (verbose_)
+            std::cout << "Sounds: " << count16 << std::endl;
 
-    serializeSize<uint16_t>(count16, Graphics.size());
-    if (gv < GV_AoE) {
-        serializeSub<Graphic>(Graphics, count16);
-    } else {
-        serialize<int32_t>(GraphicPointers, count16);
-        serializeSubWithPointers<Graphic>(Graphics, count16, GraphicPointers);
-    }
+        serializeSub<Sound>(Sounds, count16);
+        break;
 
-//    auto pos_cnt = tellg();
-    if (verbose_) {
-        std::cout << "Graphics: " << Graphics.size() << std::endl;
-    }
-    serialize<ISerializable>(TerrainBlock);
+    case SECTION_GRAPHICS:
+        serializeSize<uint16_t>(count16, Graphics.size());
+        if (gv < GV_AoE) {
+            serializeSub<Graphic>(Graphics, count16);
+        } else {
+            serialize<int32_t>(GraphicPointers, count16);
+            serializeSubWithPointers<Graphic>(Graphics, count16, GraphicPointers);
+        }
 
-    if (verbose_) {
-        std::cout << "Tile sizes: " << TerrainBlock.TileSizes.size() << std::endl;
-        std::cout << "Terrains: " << TerrainBlock.Terrains.size() << std::endl;
-        std::cout << "Borders: " << TerrainBlock.TerrainBorders.size() << std::endl;
-        std::cout << "Some bytes: " << TerrainBlock.SomeBytes.size() << std::endl;
-        std::cout << "Some ints: " << TerrainBlock.SomeInt32.size() << std::endl;
-//        pos_cnt = tellg() - pos_cnt;
-//        std::cout << "Terrain block "
-//                  << "(0x" << std::hex << pos_cnt;
-//        std::cout << " to 0x" << tellg() << std::dec << ") size " << pos_cnt << std::endl;
-    }
+        if (verbose_) {
+            std::cout << "Graphics: " << Graphics.size() << std::endl;
+        }
+        break;
 
-    // This data seems to be needed only in AoE and RoR.
-    // In later games it is removable.
-    // It exists in Star Wars games too, but is not used.
-    serialize<ISerializable>(RandomMaps);
+    case SECTION_TERRAIN_BLOCK:
+        serialize<ISerializable>(TerrainBlock);
 
-    if (verbose_)
-        std::cout << "Random maps: " << RandomMaps.Maps.size() << std::endl;
+        if (verbose_) {
+            std::cout << "Tile sizes: " << TerrainBlock.TileSizes.size() << std::endl;
+            std::cout << "Terrains: " << TerrainBlock.Terrains.size() << std::endl;
+            std::cout << "Borders: " << TerrainBlock.TerrainBorders.size() << std::endl;
+            std::cout << "Some bytes: " << TerrainBlock.SomeBytes.size() << std::endl;
+            std::cout << "Some ints: " << TerrainBlock.SomeInt32.size() << std::endl;
+        }
+        break;
 
-    serializeSize<uint32_t>(count32, Effects.size());
+    case SECTION_RANDOM_MAPS:
+        // This data seems to be needed only in AoE and RoR.
+        // In later games it is removable.
+        // It exists in Star Wars games too, but is not used.
+        serialize<ISerializable>(RandomMaps);
 
-    if (verbose_)
-        std::cout << "Effects: " << count32 << std::endl;
+        if (verbose_)
+            std::cout << "Random maps: " << RandomMaps.Maps.size() << std::endl;
+        break;
 
-    serializeSub<Effect>(Effects, count32);
+    case SECTION_EFFECTS:
+        serializeSize<uint32_t>(count32, Effects.size());
 
-    if (gv >= GV_SWGB) //pos: 0x111936
-    {
-        serializeSize<uint16_t>(count16, UnitLines.size());
-        serializeSub<UnitLine>(UnitLines, count16);
-    }
+        if (verbose_)
+            std::cout << "Effects: " << count32 << std::endl;
 
-    if (gv >= GV_AoK) {
-        serializeSize<uint32_t>(count32, UnitHeaders.size());
+        serializeSub<Effect>(Effects, count32);
+        break;
 
-        if (verbose_)
-            std::cout << "Units: " << count32 << std::endl;
+    case SECTION_UNIT_LINES:
+        if (gv >= GV_SWGB) //pos: 0x111936
+        {
+            serializeSize<uint16_t>(count16, UnitLines.size());
+            serializeSub<UnitLine>(UnitLines, count16);
+        }
+        break;
 
-        serializeSub<UnitHeader>(UnitHeaders, count32);
-    }
+    case SECTION_UNIT_HEADERS:
+        if (gv >= GV_AoK) {
+            serializeSize<uint32_t>(count32, UnitHeaders.size());
 
-    serializeSize<uint16_t>(count16, Civs.size());
+            if (verbose_)
+                std::cout << "Units: " << count32 << std::endl;
 
-    if (verbose_)
-        std::cout << "Civs: " << count16 << std::endl;
+            serializeSub<UnitHeader>(UnitHeaders, count32);
+        }
+        break;
 
-    serializeSub<Civ>(Civs, count16);
+    case SECTION_CIVS:
+        serializeSize<uint16_t>(count16, Civs.size());
 
-    if (gv >= GV_SWGB)
-        serialize<int8_t>(SUnknown7);
+        if (verbose_)
+            std::cout << "Civs: " << count16 << std::endl;
 
-    serializeSize<uint16_t>(count16, Techs.size());
+        if (isOperation(OP_READ))
+            readCivs(count16);
+        else
+            serializeSub<Civ>(Civs, count16);
 
-    if (verbose_)
-        std::cout << "Techs: " << count16 << std::endl;
+        if (gv >= GV_SWGB)
+            serialize<int8_t>(SUnknown7);
+        break;
 
-    serializeSub<Tech>(Techs, count16);
+    case SECTION_TECHS:
+        serializeSize<uint16_t>(count16, Techs.size());
 
-//    if (verbose_) {
-//        pos_cnt = tellg();
-//        std::cout << "TechTrees (before eof) (0x" << std::hex << pos_cnt;
-//    }
+        if (verbose_)
+            std::cout << "Techs: " << count16 << std::endl;
 
-    if (gv >= GV_SWGB)
-        serialize<int8_t>(SUnknown8);
+        serializeSub<Tech>(Techs, count16);
 
-    if (gv >= GV_AoKA) // 9.38
-    {
-        serialize<int32_t>(TimeSlice);
-        serialize<int32_t>(UnitKillRate);
-        serialize<int32_t>(UnitKillTotal);
-        serialize<int32_t>(UnitHitPointRate);
-        serialize<int32_t>(UnitHitPointTotal);
-        serialize<int32_t>(RazingKillRate);
-        serialize<int32_t>(RazingKillTotal);
+        if (gv >= GV_SWGB)
+            serialize<int8_t>(SUnknown8);
+        break;
 
-        serialize<ISerializable>(TechTree);
-    }
+    case SECTION_TECH_TREE:
+        if (gv >= GV_AoKA) // 9.38
+        {
+            serialize<int32_t>(TimeSlice);
+            serialize<int32_t>(UnitKillRate);
+            serialize<int32_t>(UnitKillTotal);
+            serialize<int32_t>(UnitHitPointRate);
+            serialize<int32_t>(UnitHitPointTotal);
+            serialize<int32_t>(RazingKillRate);
+            serialize<int32_t>(RazingKillTotal);
 
-//    if (verbose_) {
-//        pos_cnt = tellg() - pos_cnt;
-//        std::cout << " to 0x" << tellg() << std::dec << ") size " << pos_cnt << std::endl;
-//    }
+            serialize<ISerializable>(TechTree);
+        }
+        break;
 
-    compressor_.endCompression();
+    default:
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+void DatFile::clearSection(Section section)
+{
+    switch (section) {
+    case SECTION_PLAYER_COLOURS:
+        PlayerColours.clear();
+        break;
+    case SECTION_SOUNDS:
+        Sounds.clear();
+        break;
+    case SECTION_GRAPHICS:
+        GraphicPointers.clear();
+        Graphics.clear();
+        break;
+    case SECTION_TERRAIN_BLOCK:
+        TerrainBlock.Terrains.clear();
+        TerrainBlock.TerrainBorders.clear();
+        TerrainBlock.AoEAlphaUnknown.clear();
+        TerrainBlock.SomeBytes.clear();
+        TerrainBlock.SomeInt32.clear();
+        break;
+    case SECTION_RANDOM_MAPS:
+        RandomMaps.Maps.clear();
+        break;
+    case SECTION_EFFECTS:
+        Effects.clear();
+        break;
+    case SECTION_UNIT_LINES:
+        UnitLines.clear();
+        break;
+    case SECTION_UNIT_HEADERS:
+        UnitHeaders.clear();
+        break;
+    case SECTION_CIVS:
+        Civs.clear();
+        break;
+    case SECTION_TECHS:
+        Techs.clear();
+        break;
+    case SECTION_TECH_TREE:
+        TechTree.TechTreeAges.clear();
+        TechTree.BuildingConnections.clear();
+        TechTree.UnitConnections.clear();
+        TechTree.ResearchConnections.clear();
+        break;
+    default:
+        break;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -267,24 +1143,10 @@ void DatFile::unload()
     FloatPtrTerrainTables.clear();
     TerrainPassGraphicPointers.clear();
     TerrainRestrictions.clear();
-    PlayerColours.clear();
-    Sounds.clear();
-    GraphicPointers.clear();
-    Graphics.clear();
-    TerrainBlock.Terrains.clear();
-    TerrainBlock.TerrainBorders.clear();
-    TerrainBlock.AoEAlphaUnknown.clear();
-    TerrainBlock.SomeBytes.clear();
-    TerrainBlock.SomeInt32.clear();
-    RandomMaps.Maps.clear();
-    Effects.clear();
-    UnitLines.clear();
-    UnitHeaders.clear();
-    Civs.clear();
-    Techs.clear();
-    TechTree.TechTreeAges.clear();
-    TechTree.BuildingConnections.clear();
-    TechTree.UnitConnections.clear();
-    TechTree.ResearchConnections.clear();
+
+    for (int i = 0; i < SECTION_COUNT; ++i)
+        clearSection(Section(i));
+
+    releaseRawBody();
 }
 }
@@ -0,0 +1,364 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "genie/dat/DatFingerprint.h"
+
+#include <unordered_map>
+
+#include "DatObjects.h"
+
+namespace genie {
+
+namespace {
+
+/// Units shared by several civs are hashed once.
+typedef std::unordered_map<const Unit *, uint64_t> UnitHashCache;
+
+//------------------------------------------------------------------------------
+/// Hash over a list of hashes, the pointers of the list and seed.
+//
+uint64_t rollUp(const std::vector<uint64_t> &hashes,
+                const std::vector<int32_t> *pointers = 0, uint64_t seed = 0)
+{
+    if (pointers)
+        seed = XxHash64::of(pointers->data(), pointers->size() * sizeof(int32_t), seed);
+
+    return XxHash64::of(hashes.data(), hashes.size() * sizeof(uint64_t), seed);
+}
+
+//------------------------------------------------------------------------------
+int32_t pointerAt(const std::vector<int32_t> *pointers, size_t i)
+{
+    return pointers && i < pointers->size() ? (*pointers)[i] : 1;
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+std::vector<uint64_t> hashList(ObjectCodec &codec, std::vector<T> &list,
+                               const std::vector<int32_t> *pointers = 0)
+{
+    std::vector<uint64_t> hashes(list.size(), 0);
+
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (pointerAt(pointers, i) != 0)
+            hashes[i] = codec.write(list[i]);
+    }
+
+    return hashes;
+}
+
+//------------------------------------------------------------------------------
+uint64_t hashUnit(ObjectCodec &codec, Civ &civ, size_t i, UnitHashCache *cache)
+{
+    if (pointerAt(&civ.UnitPointers, i) == 0)
+        return 0;
+
+    // Only serialized, editing would unshare the unit.
+    Unit &unit = const_cast<Unit &>(civ.getUnit(i));
+
+    if (!cache || !civ.hasSharedUnits())
+        return codec.write(unit);
+
+    auto cached = cache->find(&unit);
+
+    if (cached != cache->end())
+        return cached->second;
+
+    return (*cache)[&unit] = codec.write(unit);
+}
+
+//------------------------------------------------------------------------------
+std::vector<uint64_t> hashUnits(ObjectCodec &codec, Civ &civ, UnitHashCache *cache)
+{
+    std::vector<uint64_t> hashes(civ.getUnitCount());
+
+    for (size_t i = 0; i < hashes.size(); ++i)
+        hashes[i] = hashUnit(codec, civ, i, cache);
+
+    return hashes;
+}
+}
+
+//------------------------------------------------------------------------------
+DatFingerprint::DatFingerprint() :
+    sections_(DatFile::SECTION_COUNT),
+    objects_(DatFile::SECTION_COUNT)
+{
+}
+
+//------------------------------------------------------------------------------
+DatFingerprint::~DatFingerprint()
+{
+}
+
+//------------------------------------------------------------------------------
+SerializationContext DatFingerprint::fileContext(DatFile &file)
+{
+    // The context may still hold the count of the last load.
+    SerializationContext context = file.context();
+    context.terrain_restriction_count = file.TerrainsUsed1;
+
+    return context;
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::build(DatFile &file)
+{
+    file.loadAllSections();
+
+    sections_.assign(DatFile::SECTION_COUNT, 0);
+    objects_.assign(DatFile::SECTION_COUNT, std::vector<uint64_t>());
+
+    for (int i = 0; i < DatFile::SECTION_COUNT; ++i)
+        hashSection(file, DatFile::Section(i));
+
+    updateHeader(file);
+}
+
+//------------------------------------------------------------------------------
+uint64_t DatFingerprint::getFileHash(void) const
+{
+    return fileHash_;
+}
+
+//------------------------------------------------------------------------------
+uint64_t DatFingerprint::getHeaderHash(void) const
+{
+    return headerHash_;
+}
+
+//------------------------------------------------------------------------------
+uint64_t DatFingerprint::getSectionHash(DatFile::Section section) const
+{
+    return sections_.at(section);
+}
+
+//------------------------------------------------------------------------------
+const std::vector<uint64_t> &DatFingerprint::getObjectHashes(DatFile::Section section) const
+{
+    return objects_.at(section);
+}
+
+//------------------------------------------------------------------------------
+const std::vector<uint64_t> &DatFingerprint::getUnitHashes(size_t civ) const
+{
+    return units_.at(civ);
+}
+
+//------------------------------------------------------------------------------
+uint64_t DatFingerprint::getCivFieldsHash(size_t civ) const
+{
+    return civFields_.at(civ);
+}
+
+//------------------------------------------------------------------------------
+uint64_t DatFingerprint::getFileFieldsHash(void) const
+{
+    return fileFieldsHash_;
+}
+
+//------------------------------------------------------------------------------
+const std::vector<uint64_t> &DatFingerprint::getTerrainRestrictionHashes(void) const
+{
+    return terrainRestrictions_;
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::updateHeader(DatFile &file)
+{
+    ObjectCodec codec(file.getGameVersion(), fileContext(file));
+
+    FileFields fields(file);
+    fileFieldsHash_ = codec.write(fields);
+    terrainRestrictions_ = hashList(codec, file.TerrainRestrictions);
+
+    rollUpHeader();
+    rollUpFile();
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::updateSection(DatFile &file, DatFile::Section section)
+{
+    hashSection(file, section);
+    rollUpFile();
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::updateObject(DatFile &file, DatFile::Section section,
+                                  size_t index)
+{
+    ObjectCodec codec(file.getGameVersion(), fileContext(file));
+    std::vector<uint64_t> &hashes = objects_.at(section);
+
+    switch (section) {
+    case DatFile::SECTION_PLAYER_COLOURS:
+        hashes.at(index) = codec.write(file.PlayerColours.at(index));
+        break;
+    case DatFile::SECTION_SOUNDS:
+        hashes.at(index) = codec.write(file.Sounds.at(index));
+        break;
+    case DatFile::SECTION_GRAPHICS:
+        hashes.at(index) = pointerAt(&file.GraphicPointers, index) == 0
+                               ? 0
+                               : codec.write(file.Graphics.at(index));
+        break;
+    case DatFile::SECTION_EFFECTS:
+        hashes.at(index) = codec.write(file.Effects.at(index));
+        break;
+    case DatFile::SECTION_UNIT_LINES:
+        hashes.at(index) = codec.write(file.UnitLines.at(index));
+        break;
+    case DatFile::SECTION_UNIT_HEADERS:
+        hashes.at(index) = codec.write(file.UnitHeaders.at(index));
+        break;
+    case DatFile::SECTION_CIVS: {
+        Civ &civ = file.Civs.at(index);
+        CivFields fields(civ);
+
+        civFields_.at(index) = codec.write(fields);
+        units_.at(index) = hashUnits(codec, civ, 0);
+        rollUpCiv(file, index);
+        break;
+    }
+    case DatFile::SECTION_TECHS:
+        hashes.at(index) = codec.write(file.Techs.at(index));
+        break;
+    default:
+        // The other sections are a single object.
+        hashSection(file, section);
+        rollUpFile();
+        return;
+    }
+
+    rollUpSection(file, section);
+    rollUpFile();
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::updateUnit(DatFile &file, size_t civ, size_t unit)
+{
+    ObjectCodec codec(file.getGameVersion(), fileContext(file));
+
+    units_.at(civ).at(unit) = hashUnit(codec, file.Civs.at(civ), unit, 0);
+
+    rollUpCiv(file, civ);
+    rollUpSection(file, DatFile::SECTION_CIVS);
+    rollUpFile();
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::hashSection(DatFile &file, DatFile::Section section)
+{
+    ObjectCodec codec(file.getGameVersion(), fileContext(file));
+    std::vector<uint64_t> &hashes = objects_.at(section);
+
+    switch (section) {
+    case DatFile::SECTION_PLAYER_COLOURS:
+        hashes = hashList(codec, file.PlayerColours);
+        break;
+    case DatFile::SECTION_SOUNDS:
+        hashes = hashList(codec, file.Sounds);
+        break;
+    case DatFile::SECTION_GRAPHICS:
+        hashes = hashList(codec, file.Graphics, &file.GraphicPointers);
+        break;
+    case DatFile::SECTION_TERRAIN_BLOCK:
+        hashes.assign(1, codec.write(file.TerrainBlock));
+        break;
+    case DatFile::SECTION_RANDOM_MAPS:
+        hashes.assign(1, codec.write(file.RandomMaps));
+        break;
+    case DatFile::SECTION_EFFECTS:
+        hashes = hashList(codec, file.Effects);
+        break;
+    case DatFile::SECTION_UNIT_LINES:
+        hashes = hashList(codec, file.UnitLines);
+        break;
+    case DatFile::SECTION_UNIT_HEADERS:
+        hashes = hashList(codec, file.UnitHeaders);
+        break;
+    case DatFile::SECTION_CIVS: {
+        UnitHashCache cache;
+
+        civFields_.resize(file.Civs.size());
+        units_.resize(file.Civs.size());
+        hashes.resize(file.Civs.size());
+
+        for (size_t i = 0; i < file.Civs.size(); ++i) {
+            CivFields fields(file.Civs[i]);
+
+            civFields_[i] = codec.write(fields);
+            units_[i] = hashUnits(codec, file.Civs[i], &cache);
+            rollUpCiv(file, i);
+        }
+        break;
+    }
+    case DatFile::SECTION_TECHS:
+        hashes = hashList(codec, file.Techs);
+        break;
+    case DatFile::SECTION_TECH_TREE:
+        // Not stored before AoK.
+        hashes.assign(1, file.getGameVersion() >= GV_AoKA ? codec.write(file.TechTree) : 0);
+        break;
+    default:
+        break;
+    }
+
+    rollUpSection(file, section);
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::rollUpHeader(void)
+{
+    headerHash_ = rollUp(terrainRestrictions_, 0, fileFieldsHash_);
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::rollUpSection(DatFile &file, DatFile::Section section)
+{
+    const std::vector<uint64_t> &hashes = objects_.at(section);
+
+    switch (section) {
+    case DatFile::SECTION_GRAPHICS:
+        sections_.at(section) = rollUp(hashes, &file.GraphicPointers);
+        break;
+    case DatFile::SECTION_TERRAIN_BLOCK:
+    case DatFile::SECTION_RANDOM_MAPS:
+    case DatFile::SECTION_TECH_TREE:
+        sections_.at(section) = hashes.at(0);
+        break;
+    default:
+        sections_.at(section) = rollUp(hashes);
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::rollUpCiv(DatFile &file, size_t civ)
+{
+    objects_.at(DatFile::SECTION_CIVS).at(civ) =
+        rollUp(units_.at(civ), &file.Civs.at(civ).UnitPointers, civFields_.at(civ));
+}
+
+//------------------------------------------------------------------------------
+void DatFingerprint::rollUpFile(void)
+{
+    fileHash_ = rollUp(sections_, 0, headerHash_);
+}
+}
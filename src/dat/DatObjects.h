@@ -0,0 +1,212 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GENIE_DATOBJECTS_H
+#define GENIE_DATOBJECTS_H
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "genie/dat/DatFile.h"
+#include "genie/file/MemoryStream.h"
+#include "genie/util/Hash.h"
+
+// Helpers of DatPatch and DatFingerprint to handle the objects of a dat file
+// one by one.
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+/// Serializes objects of a dat file on their own, with the game version and
+/// context of the file. The objects are bound to the codec only while they are
+/// serialized.
+//
+class ObjectCodec : public ISerializable
+{
+public:
+    ObjectCodec(GameVersion gv, const SerializationContext &fileContext)
+    {
+        setGameVersion(gv);
+        context() = fileContext;
+        context().unit_pool = 0;
+    }
+
+    //----------------------------------------------------------------------------
+    /// Serializes object into the buffer, overwriting the previous one.
+    ///
+    /// @return hash of the serialized object
+    //
+    uint64_t write(ISerializable &object)
+    {
+        out_.buffer()->clear();
+        setOperation(OP_WRITE);
+        setOStream(out_);
+        object.serializeSubObject(this);
+
+        return XxHash64::of(out_.buffer()->data(), out_.buffer()->size());
+    }
+
+    //----------------------------------------------------------------------------
+    /// @return copy of the object serialized last
+    //
+    std::vector<char> data(void) const
+    {
+        const MemoryWriteBuffer &buffer = *const_cast<MemoryOStream &>(out_).buffer();
+        return std::vector<char>(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    //----------------------------------------------------------------------------
+    void read(ISerializable &object, const std::vector<char> &data)
+    {
+        MemoryIStream in(data.data(), data.size());
+
+        setOperation(OP_READ);
+        setIStream(in);
+
+        try {
+            object.serializeSubObject(this);
+        } catch (...) {
+            resetIStream();
+            throw;
+        }
+
+        resetIStream();
+
+        if (in.buffer()->position() != data.size())
+            throw std::ios_base::failure("Dat patch entry doesn't match the object");
+    }
+
+    //----------------------------------------------------------------------------
+    void setTerrainRestrictionCount(unsigned short count)
+    {
+        context().terrain_restriction_count = count;
+    }
+
+protected:
+    void serializeObject(void) override {}
+
+private:
+    MemoryOStream out_;
+};
+
+//------------------------------------------------------------------------------
+/// Base of loose members stored in a layout that doesn't depend
+/// on the game version.
+//
+class LooseFields : public ISerializable
+{
+protected:
+    //----------------------------------------------------------------------------
+    void serializeString(std::string &str)
+    {
+        uint16_t len;
+        serializeSize<uint16_t>(len, str, false);
+
+        if (isOperation(OP_READ))
+            str.clear();
+
+        serialize(str, len);
+    }
+};
+
+//------------------------------------------------------------------------------
+/// The members of DatFile that don't belong to an object.
+//
+class FileFields : public LooseFields
+{
+public:
+    FileFields(DatFile &file) :
+        file_(file)
+    {
+    }
+
+protected:
+    void serializeObject(void) override
+    {
+        uint16_t count;
+
+        serializeString(file_.FileVersion);
+
+        serializeSize<uint16_t>(count, file_.FloatPtrTerrainTables.size());
+        serialize<int32_t>(file_.FloatPtrTerrainTables, count);
+        serializeSize<uint16_t>(count, file_.TerrainPassGraphicPointers.size());
+        serialize<int32_t>(file_.TerrainPassGraphicPointers, count);
+
+        serialize<uint16_t>(file_.TerrainsUsed1);
+
+        // Members not in the file stay uninitialized, leave them out.
+        if (getGameVersion() >= GV_SWGB) {
+            serialize<int32_t>(file_.SUnknown2);
+            serialize<int32_t>(file_.SUnknown3);
+            serialize<int32_t>(file_.SUnknown4);
+            serialize<int32_t>(file_.SUnknown5);
+            serialize<int8_t>(file_.SUnknown7);
+            serialize<int8_t>(file_.SUnknown8);
+        }
+
+        if (getGameVersion() >= GV_AoKA) {
+            serialize<int32_t>(file_.TimeSlice);
+            serialize<int32_t>(file_.UnitKillRate);
+            serialize<int32_t>(file_.UnitKillTotal);
+            serialize<int32_t>(file_.UnitHitPointRate);
+            serialize<int32_t>(file_.UnitHitPointTotal);
+            serialize<int32_t>(file_.RazingKillRate);
+            serialize<int32_t>(file_.RazingKillTotal);
+        }
+    }
+
+private:
+    DatFile &file_;
+};
+
+//------------------------------------------------------------------------------
+/// The members of a civ except its units.
+//
+class CivFields : public LooseFields
+{
+public:
+    CivFields(Civ &civ) :
+        civ_(&civ)
+    {
+    }
+
+protected:
+    void serializeObject(void) override
+    {
+        uint16_t count;
+
+        serialize<int8_t>(civ_->PlayerType);
+        serializeString(civ_->Name);
+        serializeString(civ_->Name2);
+        serialize<int16_t>(civ_->TechTreeID);
+        serialize<int16_t>(civ_->TeamBonusID);
+        serializeSize<uint16_t>(count, civ_->Resources.size());
+        serialize<float>(civ_->Resources, count);
+        serialize<int8_t>(civ_->IconSet);
+        serializeSize<uint16_t>(count, civ_->UniqueUnitsTechs.size());
+        serialize<int16_t>(civ_->UniqueUnitsTechs, count);
+    }
+
+private:
+    Civ *civ_;
+};
+}
+
+#endif // GENIE_DATOBJECTS_H
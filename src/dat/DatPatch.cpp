@@ -0,0 +1,553 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "genie/dat/DatPatch.h"
+
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+#include "genie/dat/DatFingerprint.h"
+#include "DatObjects.h"
+
+namespace genie {
+
+namespace {
+
+/// Section to mark dirty for each item, SECTION_COUNT for none.
+const DatFile::Section ITEM_SECTIONS[DatPatch::ITEM_COUNT] = {
+    DatFile::SECTION_COUNT, // FILE_FIELDS, handled in apply()
+    DatFile::SECTION_COUNT, // TERRAIN_RESTRICTIONS, always written
+    DatFile::SECTION_PLAYER_COLOURS,
+    DatFile::SECTION_SOUNDS,
+    DatFile::SECTION_GRAPHICS,
+    DatFile::SECTION_TERRAIN_BLOCK,
+    DatFile::SECTION_RANDOM_MAPS,
+    DatFile::SECTION_EFFECTS,
+    DatFile::SECTION_UNIT_LINES,
+    DatFile::SECTION_UNIT_HEADERS,
+    DatFile::SECTION_CIVS,
+    DatFile::SECTION_CIVS,
+    DatFile::SECTION_TECHS,
+    DatFile::SECTION_TECH_TREE
+};
+
+//------------------------------------------------------------------------------
+/// Collects the entries for the objects whose hashes differ between two
+/// files. Only changed objects are serialized into the patch.
+//
+class Differ
+{
+public:
+    Differ(ObjectCodec &to, std::vector<DatPatch::Entry> &entries) :
+        to_(to),
+        entries_(entries)
+    {
+    }
+
+    //----------------------------------------------------------------------------
+    void single(uint8_t item, uint64_t fromHash, uint64_t toHash,
+                ISerializable &to)
+    {
+        if (fromHash != toHash) {
+            to_.write(to);
+            add(item, 0, 0, 1).Data = to_.data();
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    /// Compares two lists of objects by the hashes of their elements.
+    /// Pointers are given for lists where elements can be missing.
+    ///
+    /// @param to returns element i of the new list
+    //
+    template <typename To>
+    void list(uint8_t item, uint32_t civ, const std::vector<uint64_t> &fromHashes,
+              const std::vector<uint64_t> &toHashes,
+              const std::vector<int32_t> *fromPointers,
+              const std::vector<int32_t> *toPointers, To to)
+    {
+        if (fromHashes.size() != toHashes.size())
+            add(item, civ, toHashes.size(), 1).Resize = true;
+
+        for (size_t i = 0; i < toHashes.size(); ++i) {
+            int32_t ptr = pointer(toPointers, i);
+
+            if (i < fromHashes.size() && pointer(fromPointers, i) == ptr
+                && fromHashes[i] == toHashes[i]) {
+                continue;
+            }
+
+            DatPatch::Entry &entry = add(item, civ, i, ptr);
+
+            if (ptr != 0) {
+                to_.write(to(i));
+                entry.Data = to_.data();
+            }
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    template <typename T>
+    void list(uint8_t item, const std::vector<uint64_t> &fromHashes,
+              const std::vector<uint64_t> &toHashes, std::vector<T> &to,
+              const std::vector<int32_t> *fromPointers = 0,
+              const std::vector<int32_t> *toPointers = 0)
+    {
+        list(item, 0, fromHashes, toHashes, fromPointers, toPointers,
+             [&](size_t i) -> ISerializable & { return to[i]; });
+    }
+
+private:
+    ObjectCodec &to_;
+    std::vector<DatPatch::Entry> &entries_;
+
+    //----------------------------------------------------------------------------
+    static int32_t pointer(const std::vector<int32_t> *pointers, size_t i)
+    {
+        return pointers && i < pointers->size() ? (*pointers)[i] : 1;
+    }
+
+    //----------------------------------------------------------------------------
+    DatPatch::Entry &add(uint8_t item, uint32_t civ, uint32_t index,
+                         int32_t pointer)
+    {
+        entries_.emplace_back();
+
+        DatPatch::Entry &entry = entries_.back();
+        entry.Item = item;
+        entry.Civ = civ;
+        entry.Index = index;
+        entry.Pointer = pointer;
+
+        return entry;
+    }
+};
+
+//------------------------------------------------------------------------------
+/// Applies a RESIZE or SET entry to a list of objects.
+//
+template <typename T>
+void applyTo(ObjectCodec &codec, const DatPatch::Entry &entry,
+             std::vector<T> &list, std::vector<int32_t> *pointers = 0)
+{
+    if (entry.Resize) {
+        list.resize(entry.Index);
+
+        if (pointers)
+            pointers->resize(entry.Index, 0);
+
+        return;
+    }
+
+    T &object = list.at(entry.Index);
+
+    if (pointers)
+        pointers->at(entry.Index) = entry.Pointer;
+
+    if (entry.Pointer != 0) {
+        codec.read(object, entry.Data);
+    } else {
+        object = T();
+        object.setGameVersion(codec.getGameVersion());
+    }
+}
+
+/// Merge order of entries: item, civ, resize before set, index.
+typedef std::tuple<uint8_t, uint32_t, bool, uint32_t> EntryKey;
+
+//------------------------------------------------------------------------------
+EntryKey keyOf(const DatPatch::Entry &entry)
+{
+    return EntryKey(entry.Item, entry.Civ, !entry.Resize,
+                    entry.Resize ? 0 : entry.Index);
+}
+}
+
+//------------------------------------------------------------------------------
+bool DatPatch::Entry::sameTarget(const Entry &other) const
+{
+    return keyOf(*this) == keyOf(other);
+}
+
+//------------------------------------------------------------------------------
+bool DatPatch::Entry::operator==(const Entry &other) const
+{
+    return sameTarget(other) && Index == other.Index
+           && Pointer == other.Pointer && Data == other.Data;
+}
+
+//------------------------------------------------------------------------------
+DatPatch::DatPatch()
+{
+}
+
+//------------------------------------------------------------------------------
+DatPatch::~DatPatch()
+{
+}
+
+//------------------------------------------------------------------------------
+SerializationContext DatPatch::fileContext(DatFile &file)
+{
+    // The context may still hold the count of the last load.
+    SerializationContext context = file.context();
+    context.terrain_restriction_count = file.TerrainsUsed1;
+
+    return context;
+}
+
+//------------------------------------------------------------------------------
+void DatPatch::diff(DatFile &from, DatFile &to)
+{
+    if (from.getGameVersion() != to.getGameVersion())
+        throw std::invalid_argument("Can't diff dat files of different game versions");
+
+    DatFingerprint fromPrint, toPrint;
+    fromPrint.build(from);
+    toPrint.build(to);
+
+    setGameVersion(to.getGameVersion());
+    Entries.clear();
+
+    if (fromPrint.getFileHash() == toPrint.getFileHash())
+        return;
+
+    ObjectCodec codec(to.getGameVersion(), fileContext(to));
+    Differ differ(codec, Entries);
+
+    FileFields toFields(to);
+    differ.single(FILE_FIELDS, fromPrint.getFileFieldsHash(),
+                  toPrint.getFileFieldsHash(), toFields);
+    differ.list(TERRAIN_RESTRICTIONS, fromPrint.getTerrainRestrictionHashes(),
+                toPrint.getTerrainRestrictionHashes(), to.TerrainRestrictions);
+
+    // Sections with equal hashes are skipped as a whole.
+    auto changed = [&](DatFile::Section section) {
+        return fromPrint.getSectionHash(section) != toPrint.getSectionHash(section);
+    };
+    auto hashes = [](const DatFingerprint &print, DatFile::Section section)
+        -> const std::vector<uint64_t> & { return print.getObjectHashes(section); };
+
+    if (changed(DatFile::SECTION_PLAYER_COLOURS)) {
+        differ.list(PLAYER_COLOURS, hashes(fromPrint, DatFile::SECTION_PLAYER_COLOURS),
+                    hashes(toPrint, DatFile::SECTION_PLAYER_COLOURS), to.PlayerColours);
+    }
+
+    if (changed(DatFile::SECTION_SOUNDS)) {
+        differ.list(SOUNDS, hashes(fromPrint, DatFile::SECTION_SOUNDS),
+                    hashes(toPrint, DatFile::SECTION_SOUNDS), to.Sounds);
+    }
+
+    if (changed(DatFile::SECTION_GRAPHICS)) {
+        differ.list(GRAPHICS, hashes(fromPrint, DatFile::SECTION_GRAPHICS),
+                    hashes(toPrint, DatFile::SECTION_GRAPHICS), to.Graphics,
+                    &from.GraphicPointers, &to.GraphicPointers);
+    }
+
+    if (changed(DatFile::SECTION_TERRAIN_BLOCK)) {
+        differ.single(TERRAIN_BLOCK, fromPrint.getSectionHash(DatFile::SECTION_TERRAIN_BLOCK),
+                      toPrint.getSectionHash(DatFile::SECTION_TERRAIN_BLOCK), to.TerrainBlock);
+    }
+
+    if (changed(DatFile::SECTION_RANDOM_MAPS)) {
+        differ.single(RANDOM_MAPS, fromPrint.getSectionHash(DatFile::SECTION_RANDOM_MAPS),
+                      toPrint.getSectionHash(DatFile::SECTION_RANDOM_MAPS), to.RandomMaps);
+    }
+
+    if (changed(DatFile::SECTION_EFFECTS)) {
+        differ.list(EFFECTS, hashes(fromPrint, DatFile::SECTION_EFFECTS),
+                    hashes(toPrint, DatFile::SECTION_EFFECTS), to.Effects);
+    }
+
+    if (changed(DatFile::SECTION_UNIT_LINES)) {
+        differ.list(UNIT_LINES, hashes(fromPrint, DatFile::SECTION_UNIT_LINES),
+                    hashes(toPrint, DatFile::SECTION_UNIT_LINES), to.UnitLines);
+    }
+
+    if (changed(DatFile::SECTION_UNIT_HEADERS)) {
+        differ.list(UNIT_HEADERS, hashes(fromPrint, DatFile::SECTION_UNIT_HEADERS),
+                    hashes(toPrint, DatFile::SECTION_UNIT_HEADERS), to.UnitHeaders);
+    }
+
+    if (changed(DatFile::SECTION_CIVS)) {
+        std::vector<uint64_t> fromCivFields, toCivFields;
+        std::vector<CivFields> toCivs(to.Civs.begin(), to.Civs.end());
+
+        for (size_t i = 0; i < from.Civs.size(); ++i)
+            fromCivFields.push_back(fromPrint.getCivFieldsHash(i));
+
+        for (size_t i = 0; i < to.Civs.size(); ++i)
+            toCivFields.push_back(toPrint.getCivFieldsHash(i));
+
+        differ.list(CIVS, fromCivFields, toCivFields, toCivs);
+
+        const std::vector<uint64_t> &fromCivHashes = hashes(fromPrint, DatFile::SECTION_CIVS);
+        const std::vector<uint64_t> &toCivHashes = hashes(toPrint, DatFile::SECTION_CIVS);
+        const std::vector<uint64_t> none;
+
+        for (size_t i = 0; i < to.Civs.size(); ++i) {
+            bool existed = i < from.Civs.size();
+
+            if (existed && fromCivHashes[i] == toCivHashes[i])
+                continue;
+
+            Civ &civ = to.Civs[i];
+
+            // Units are only serialized, editing would unshare them.
+            differ.list(CIV_UNITS, i, existed ? fromPrint.getUnitHashes(i) : none,
+                        toPrint.getUnitHashes(i),
+                        existed ? &from.Civs[i].UnitPointers : 0, &civ.UnitPointers,
+                        [&](size_t unit) -> ISerializable & {
+                            return const_cast<Unit &>(civ.getUnit(unit));
+                        });
+        }
+    }
+
+    if (changed(DatFile::SECTION_TECHS)) {
+        differ.list(TECHS, hashes(fromPrint, DatFile::SECTION_TECHS),
+                    hashes(toPrint, DatFile::SECTION_TECHS), to.Techs);
+    }
+
+    if (changed(DatFile::SECTION_TECH_TREE)) {
+        differ.single(TECH_TREE, fromPrint.getSectionHash(DatFile::SECTION_TECH_TREE),
+                      toPrint.getSectionHash(DatFile::SECTION_TECH_TREE), to.TechTree);
+    }
+}
+
+//------------------------------------------------------------------------------
+void DatPatch::apply(DatFile &file) const
+{
+    if (file.getGameVersion() != getGameVersion())
+        throw std::invalid_argument("Dat patch is for a different game version");
+
+    file.loadAllSections();
+
+    ObjectCodec codec(file.getGameVersion(), fileContext(file));
+
+    for (const Entry &entry : Entries) {
+        switch (entry.Item) {
+        case FILE_FIELDS: {
+            FileFields fields(file);
+            codec.read(fields, entry.Data);
+            codec.setTerrainRestrictionCount(file.TerrainsUsed1);
+
+            file.markDirty(DatFile::SECTION_CIVS);
+            file.markDirty(DatFile::SECTION_TECHS);
+            file.markDirty(DatFile::SECTION_TECH_TREE);
+            break;
+        }
+        case TERRAIN_RESTRICTIONS:
+            applyTo(codec, entry, file.TerrainRestrictions);
+            break;
+        case PLAYER_COLOURS:
+            applyTo(codec, entry, file.PlayerColours);
+            break;
+        case SOUNDS:
+            applyTo(codec, entry, file.Sounds);
+            break;
+        case GRAPHICS:
+            applyTo(codec, entry, file.Graphics,
+                    getGameVersion() >= GV_AoE ? &file.GraphicPointers : 0);
+            break;
+        case TERRAIN_BLOCK:
+            codec.read(file.TerrainBlock, entry.Data);
+            break;
+        case RANDOM_MAPS:
+            codec.read(file.RandomMaps, entry.Data);
+            break;
+        case EFFECTS:
+            applyTo(codec, entry, file.Effects);
+            break;
+        case UNIT_LINES:
+            applyTo(codec, entry, file.UnitLines);
+            break;
+        case UNIT_HEADERS:
+            applyTo(codec, entry, file.UnitHeaders);
+            break;
+        case CIVS:
+            if (entry.Resize) {
+                file.Civs.resize(entry.Index);
+
+                for (Civ &civ : file.Civs)
+                    civ.setGameVersion(getGameVersion());
+            } else {
+                CivFields fields(file.Civs.at(entry.Index));
+                codec.read(fields, entry.Data);
+            }
+            break;
+        case CIV_UNITS: {
+            Civ &civ = file.Civs.at(entry.Civ);
+
+            if (entry.Resize) {
+                civ.unshareUnits();
+                applyTo(codec, entry, civ.Units, &civ.UnitPointers);
+                break;
+            }
+
+            if (entry.Index >= civ.getUnitCount())
+                throw std::out_of_range("Dat patch entry out of range");
+
+            // Changing only this civ's copy of a shared unit.
+            Unit &unit = civ.editUnit(entry.Index);
+            civ.UnitPointers.at(entry.Index) = entry.Pointer;
+
+            if (entry.Pointer != 0) {
+                codec.read(unit, entry.Data);
+            } else {
+                unit = Unit();
+                unit.setGameVersion(getGameVersion());
+            }
+            break;
+        }
+        case TECHS:
+            applyTo(codec, entry, file.Techs);
+            break;
+        case TECH_TREE:
+            codec.read(file.TechTree, entry.Data);
+            break;
+        default:
+            continue;
+        }
+
+        if (ITEM_SECTIONS[entry.Item] != DatFile::SECTION_COUNT)
+            file.markDirty(ITEM_SECTIONS[entry.Item]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void DatPatch::merge(const DatPatch &ours, const DatPatch &theirs,
+                     std::vector<Conflict> &conflicts)
+{
+    if (ours.getGameVersion() != theirs.getGameVersion())
+        throw std::invalid_argument("Can't merge dat patches of different game versions");
+
+    struct Merged {
+        const Entry *entry;
+        bool ours;
+    };
+
+    std::map<EntryKey, Merged> merged;
+
+    for (const Entry &entry : ours.Entries)
+        merged[keyOf(entry)] = Merged{ &entry, true };
+
+    for (const Entry &entry : theirs.Entries) {
+        auto inserted = merged.emplace(keyOf(entry), Merged{ &entry, false });
+        const Entry &other = *inserted.first->second.entry;
+
+        if (!inserted.second && !(other == entry))
+            conflicts.push_back(Conflict{ other, entry });
+    }
+
+    // Changes behind the end of a list shortened by the other side can't be
+    // applied anymore.
+    auto outside = [&](const Merged &change, uint8_t item, uint32_t civ,
+                       uint32_t index) -> const Merged * {
+        auto resize = merged.find(EntryKey(item, civ, false, 0));
+
+        if (resize == merged.end() || resize->second.ours == change.ours
+            || index < resize->second.entry->Index) {
+            return 0;
+        }
+
+        return &resize->second;
+    };
+
+    std::vector<Entry> entries;
+    entries.reserve(merged.size());
+
+    for (const auto &pair : merged) {
+        const Merged &change = pair.second;
+        const Entry &entry = *change.entry;
+        const Merged *resize = 0;
+
+        if (!entry.Resize)
+            resize = outside(change, entry.Item, entry.Civ, entry.Index);
+
+        if (!resize && entry.Item == CIV_UNITS)
+            resize = outside(change, CIVS, 0, entry.Civ);
+
+        if (resize) {
+            if (change.ours)
+                conflicts.push_back(Conflict{ entry, *resize->entry });
+            else
+                conflicts.push_back(Conflict{ *resize->entry, entry });
+        } else {
+            entries.push_back(entry);
+        }
+    }
+
+    setGameVersion(ours.getGameVersion());
+    Entries.swap(entries);
+}
+
+//------------------------------------------------------------------------------
+void DatPatch::unload(void)
+{
+    Entries.clear();
+}
+
+//------------------------------------------------------------------------------
+void DatPatch::serializeObject(void)
+{
+    std::string magic = "GENIEPAT";
+    serialize(magic, magic.size());
+
+    if (isOperation(OP_READ) && magic != "GENIEPAT")
+        throw std::ios_base::failure("Not a dat patch");
+
+    uint32_t format = FORMAT;
+    serialize<uint32_t>(format);
+
+    if (format != FORMAT)
+        throw std::ios_base::failure("Unsupported dat patch format");
+
+    int32_t gv = getGameVersion();
+    serialize<int32_t>(gv);
+
+    if (isOperation(OP_READ))
+        setGameVersion(GameVersion(gv));
+
+    uint32_t count;
+    serializeSize<uint32_t>(count, Entries.size());
+
+    if (isOperation(OP_READ))
+        Entries.resize(count);
+
+    for (Entry &entry : Entries) {
+        serialize<uint8_t>(entry.Item);
+
+        if (entry.Item >= ITEM_COUNT)
+            throw std::ios_base::failure("Corrupt dat patch");
+
+        uint8_t resize = entry.Resize;
+        serialize<uint8_t>(resize);
+        entry.Resize = resize != 0;
+
+        serialize<uint32_t>(entry.Civ);
+        serialize<uint32_t>(entry.Index);
+        serialize<int32_t>(entry.Pointer);
+
+        uint32_t size;
+        serializeSize<uint32_t>(size, entry.Data.size());
+        serialize<char>(entry.Data, size);
+    }
+}
+}
@@ -23,7 +23,7 @@
 namespace genie {
 
 unsigned short Terrain::terrain_count_ = 0;
-;
+
 //------------------------------------------------------------------------------
 Terrain::Terrain() :
     ElevationGraphics(TILE_TYPE_COUNT),
@@ -38,10 +38,18 @@ Terrain::~Terrain()
 }
 
 void Terrain::setGameVersion(GameVersion gv)
+{
+    const SerializationContext *ctx = rootContext();
+
+    setGameVersion(gv, ctx ? getTerrainCount(*ctx, gv) : getTerrainCount(gv));
+}
+
+//------------------------------------------------------------------------------
+void Terrain::setGameVersion(GameVersion gv, unsigned short terrainCount)
 {
     ISerializable::setGameVersion(gv);
 
-    Borders.resize(getTerrainCount(gv), 0);
+    Borders.resize(terrainCount, 0);
 }
 
 //------------------------------------------------------------------------------
@@ -66,6 +74,13 @@ unsigned short Terrain::getTerrainCount(GameVersion gv)
     return 32;
 }
 
+//------------------------------------------------------------------------------
+unsigned short Terrain::getTerrainCount(const SerializationContext &ctx,
+                                        GameVersion gv)
+{
+    return ctx.terrain_count ? ctx.terrain_count : getTerrainCount(gv);
+}
+
 //------------------------------------------------------------------------------
 unsigned short Terrain::getNameSize()
 {
@@ -134,7 +149,7 @@ void Terrain::serializeObject(void)
     serialize<int16_t>(TerrainToDraw);
     serializePair<int16_t>(TerrainDimensions);
     if (isOperation(OP_READ))
-        serialize<int16_t>(Borders, getTerrainCount(gv));
+        serialize<int16_t>(Borders, getTerrainCount(context(), gv));
     else
         serialize<int16_t>(Borders, Borders.size());
     serialize<int16_t>(TerrainUnitID, TERRAIN_UNITS_SIZE);
@@ -33,11 +33,23 @@ TerrainBlock::~TerrainBlock()
 
 //------------------------------------------------------------------------------
 void TerrainBlock::setGameVersion(GameVersion gv)
+{
+    const SerializationContext *ctx = rootContext();
+
+    setGameVersion(gv, ctx ? Terrain::getTerrainCount(*ctx, gv)
+                           : Terrain::getTerrainCount(gv));
+}
+
+//------------------------------------------------------------------------------
+void TerrainBlock::setGameVersion(GameVersion gv, unsigned short terrainCount)
 {
     ISerializable::setGameVersion(gv);
 
-    Terrains.resize(Terrain::getTerrainCount(gv));
-    updateGameVersion(Terrains);
+    Terrains.resize(terrainCount);
+
+    for (Terrain &terrain : Terrains)
+        terrain.setGameVersion(gv, terrainCount);
+
     updateGameVersion(TerrainBorders);
 
     TileSizes.resize(SharedTerrain::TILE_TYPE_COUNT);
@@ -99,7 +111,7 @@ void TerrainBlock::serializeObject(void)
         serialize<int16_t>(PaddingTS); // Padding for TileSizes (32-bit aligned)
 
     if (isOperation(OP_READ))
-        serializeSub<Terrain>(Terrains, Terrain::getTerrainCount(gv));
+        serializeSub<Terrain>(Terrains, Terrain::getTerrainCount(context(), gv));
     else
         serializeSub<Terrain>(Terrains, Terrains.size());
 
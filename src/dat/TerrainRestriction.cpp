@@ -27,9 +27,9 @@ namespace genie {
 unsigned short TerrainRestriction::terrain_count_ = 0;
 
 //------------------------------------------------------------------------------
-TerrainRestriction::TerrainRestriction() :
-    PassableBuildableDmgMultiplier(terrain_count_),
-    TerrainPassGraphics(terrain_count_)
+TerrainRestriction::TerrainRestriction(unsigned short terrainCount) :
+    PassableBuildableDmgMultiplier(terrainCount ? terrainCount : terrain_count_),
+    TerrainPassGraphics(terrainCount ? terrainCount : terrain_count_)
 {
 }
 
@@ -55,11 +55,22 @@ void TerrainRestriction::setTerrainCount(unsigned short cnt)
 //------------------------------------------------------------------------------
 void TerrainRestriction::serializeObject(void)
 {
-    serialize<float>(PassableBuildableDmgMultiplier, terrain_count_);
+    unsigned short terrain_count = context().terrain_restriction_count;
+
+    // Restrictions added with fewer terrains would leave the file short.
+    if (!isOperation(OP_READ)) {
+        if (PassableBuildableDmgMultiplier.size() < terrain_count)
+            PassableBuildableDmgMultiplier.resize(terrain_count, 0);
+
+        if (TerrainPassGraphics.size() < terrain_count)
+            TerrainPassGraphics.resize(terrain_count);
+    }
+
+    serialize<float>(PassableBuildableDmgMultiplier, terrain_count);
 
     GameVersion gv = getGameVersion();
     if (gv >= GV_AoKA || (gv >= GV_T4 && gv <= GV_LatestTap)) {
-        serializeSub<TerrainPassGraphic>(TerrainPassGraphics, terrain_count_);
+        serializeSub<TerrainPassGraphic>(TerrainPassGraphics, terrain_count);
     }
 }
 }
@@ -0,0 +1,334 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "genie/dat/UnitColumns.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace genie {
+
+namespace {
+
+const float NONE = std::numeric_limits<float>::quiet_NaN();
+
+//------------------------------------------------------------------------------
+float fieldValue(const Unit &unit, UnitColumns::Field field)
+{
+    switch (field) {
+    case UnitColumns::TYPE:
+        return unit.Type;
+    case UnitColumns::CLASS:
+        return unit.Class;
+    case UnitColumns::HIT_POINTS:
+        return unit.HitPoints;
+    case UnitColumns::LINE_OF_SIGHT:
+        return unit.LineOfSight;
+    case UnitColumns::GARRISON_CAPACITY:
+        return unit.GarrisonCapacity;
+    case UnitColumns::RESOURCE_CAPACITY:
+        return unit.ResourceCapacity;
+    case UnitColumns::SPEED:
+        return unit.Speed;
+    case UnitColumns::ROTATION_SPEED:
+        return unit.Moving.RotationSpeed;
+    case UnitColumns::SEARCH_RADIUS:
+        return unit.Action.SearchRadius;
+    case UnitColumns::WORK_RATE:
+        return unit.Action.WorkRate;
+    case UnitColumns::BASE_ARMOR:
+        return unit.Combat.BaseArmor;
+    case UnitColumns::MAX_RANGE:
+        return unit.Combat.MaxRange;
+    case UnitColumns::MIN_RANGE:
+        return unit.Combat.MinRange;
+    case UnitColumns::BLAST_WIDTH:
+        return unit.Combat.BlastWidth;
+    case UnitColumns::RELOAD_TIME:
+        return unit.Combat.ReloadTime;
+    case UnitColumns::ACCURACY_PERCENT:
+        return unit.Combat.AccuracyPercent;
+    case UnitColumns::PROJECTILE_UNIT_ID:
+        return unit.Combat.ProjectileUnitID;
+    case UnitColumns::DISPLAYED_ATTACK:
+        return unit.Combat.DisplayedAttack;
+    case UnitColumns::DISPLAYED_MELEE_ARMOUR:
+        return unit.Combat.DisplayedMeleeArmour;
+    case UnitColumns::TRAIN_TIME:
+        return unit.Creatable.TrainTime;
+    case UnitColumns::TRAIN_LOCATION_ID:
+        return unit.Creatable.TrainLocationID;
+    case UnitColumns::TOTAL_PROJECTILES:
+        return unit.Creatable.TotalProjectiles;
+    default:
+        return NONE;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Removes rows where cmp(value in column, value) is false.
+//
+template <typename Cmp>
+void filterRows(std::vector<uint32_t> &rows, const UnitColumns::Column &column,
+                float value, Cmp cmp)
+{
+    size_t kept = 0;
+
+    for (uint32_t row : rows) {
+        if (cmp(column[row], value))
+            rows[kept++] = row;
+    }
+
+    rows.resize(kept);
+}
+}
+
+//------------------------------------------------------------------------------
+UnitColumns::UnitColumns(const std::vector<Civ> &civs) :
+    civs_(civs)
+{
+    build();
+}
+
+//------------------------------------------------------------------------------
+UnitColumns::~UnitColumns()
+{
+}
+
+//------------------------------------------------------------------------------
+void UnitColumns::build(void)
+{
+    civCount_ = civs_.size();
+    unitCount_ = 0;
+
+    for (const Civ &civ : civs_)
+        unitCount_ = std::max(unitCount_, civ.getUnitCount());
+
+    size_t rowCount = getRowCount();
+
+    exists_.assign(rowCount, 0);
+    fields_.assign(FIELD_COUNT, Column(rowCount, NONE));
+    attacks_.clear();
+    armours_.clear();
+    missing_.assign(rowCount, NONE);
+
+    for (size_t civ = 0; civ < civCount_; ++civ)
+        updateCiv(civ);
+}
+
+//------------------------------------------------------------------------------
+void UnitColumns::update(size_t civ, size_t unit)
+{
+    if (civCount_ != civs_.size() || civ >= civCount_ || unit >= unitCount_
+        || civs_[civ].getUnitCount() > unitCount_) {
+        build();
+        return;
+    }
+
+    fillRow(civ, unit);
+}
+
+//------------------------------------------------------------------------------
+void UnitColumns::updateCiv(size_t civ)
+{
+    if (civCount_ != civs_.size() || civ >= civCount_
+        || civs_[civ].getUnitCount() > unitCount_) {
+        build();
+        return;
+    }
+
+    for (size_t unit = 0; unit < unitCount_; ++unit)
+        fillRow(civ, unit);
+}
+
+//------------------------------------------------------------------------------
+const UnitColumns::Column &UnitColumns::attack(int16_t cls) const
+{
+    auto it = attacks_.find(cls);
+
+    return it == attacks_.end() ? missing_ : it->second;
+}
+
+//------------------------------------------------------------------------------
+const UnitColumns::Column &UnitColumns::armour(int16_t cls) const
+{
+    auto it = armours_.find(cls);
+
+    return it == armours_.end() ? missing_ : it->second;
+}
+
+//------------------------------------------------------------------------------
+void UnitColumns::fillRow(size_t civ, size_t unit)
+{
+    size_t r = row(civ, unit);
+    const Civ &source = civs_[civ];
+
+    for (auto &it : attacks_)
+        it.second[r] = NONE;
+
+    for (auto &it : armours_)
+        it.second[r] = NONE;
+
+    exists_[r] = unit < source.getUnitCount() && unit < source.UnitPointers.size()
+                 && source.UnitPointers[unit] != 0;
+
+    if (!exists_[r]) {
+        for (int field = 0; field < FIELD_COUNT; ++field)
+            fields_[field][r] = NONE;
+        return;
+    }
+
+    const Unit &data = source.getUnit(unit);
+
+    for (int field = 0; field < FIELD_COUNT; ++field)
+        fields_[field][r] = fieldValue(data, Field(field));
+
+    setAmounts(attacks_, data.Combat.Attacks, r, getRowCount());
+    setAmounts(armours_, data.Combat.Armours, r, getRowCount());
+}
+
+//------------------------------------------------------------------------------
+void UnitColumns::setAmounts(std::map<int16_t, Column> &columns,
+                             const std::vector<unit::AttackOrArmor> &amounts,
+                             size_t row, size_t rowCount)
+{
+    for (const unit::AttackOrArmor &amount : amounts) {
+        Column &column = columns[amount.Class];
+
+        if (column.empty())
+            column.assign(rowCount, NONE);
+
+        column[row] = amount.Amount;
+    }
+}
+
+//------------------------------------------------------------------------------
+UnitQuery::UnitQuery(const UnitColumns &columns) :
+    columns_(columns)
+{
+    size_t rowCount = columns.getRowCount();
+
+    rows_.reserve(rowCount);
+
+    for (size_t row = 0; row < rowCount; ++row) {
+        if (columns.exists(row))
+            rows_.push_back(uint32_t(row));
+    }
+}
+
+//------------------------------------------------------------------------------
+UnitQuery &UnitQuery::where(const UnitColumns::Column &column, Comparison cmp,
+                            float value)
+{
+    // Every comparison with NaN is false, which drops rows without a value.
+    switch (cmp) {
+    case EQUAL:
+        filterRows(rows_, column, value, [](float a, float b) { return a == b; });
+        break;
+    case NOT_EQUAL:
+        filterRows(rows_, column, value, [](float a, float b) { return a < b || a > b; });
+        break;
+    case LESS:
+        filterRows(rows_, column, value, [](float a, float b) { return a < b; });
+        break;
+    case LESS_EQUAL:
+        filterRows(rows_, column, value, [](float a, float b) { return a <= b; });
+        break;
+    case GREATER:
+        filterRows(rows_, column, value, [](float a, float b) { return a > b; });
+        break;
+    case GREATER_EQUAL:
+        filterRows(rows_, column, value, [](float a, float b) { return a >= b; });
+        break;
+    }
+
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+UnitQuery &UnitQuery::where(UnitColumns::Field field, Comparison cmp, float value)
+{
+    return where(columns_.column(field), cmp, value);
+}
+
+//------------------------------------------------------------------------------
+UnitQuery &UnitQuery::civ(size_t civ)
+{
+    uint32_t first = uint32_t(columns_.row(civ, 0));
+    uint32_t last = first + uint32_t(columns_.getUnitCount());
+
+    auto begin = std::lower_bound(rows_.begin(), rows_.end(), first);
+    auto end = std::lower_bound(begin, rows_.end(), last);
+
+    rows_.erase(end, rows_.end());
+    rows_.erase(rows_.begin(), begin);
+
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+std::vector<float> UnitQuery::select(const UnitColumns::Column &column) const
+{
+    std::vector<float> values;
+
+    values.reserve(rows_.size());
+
+    for (uint32_t row : rows_)
+        values.push_back(column[row]);
+
+    return values;
+}
+
+//------------------------------------------------------------------------------
+size_t UnitQuery::count(void) const
+{
+    return rows_.size();
+}
+
+//------------------------------------------------------------------------------
+UnitQuery::Summary UnitQuery::summarize(const UnitColumns::Column &column) const
+{
+    Summary summary;
+
+    for (uint32_t row : rows_) {
+        float value = column[row];
+
+        if (value != value)
+            continue;
+
+        if (summary.count == 0 || value < summary.min)
+            summary.min = value;
+        if (summary.count == 0 || value > summary.max)
+            summary.max = value;
+
+        summary.sum += value;
+        ++summary.count;
+    }
+
+    if (summary.count)
+        summary.mean = summary.sum / summary.count;
+
+    return summary;
+}
+
+//------------------------------------------------------------------------------
+UnitQuery::Summary UnitQuery::summarize(UnitColumns::Field field) const
+{
+    return summarize(columns_.column(field));
+}
+}
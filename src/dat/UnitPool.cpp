@@ -0,0 +1,53 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "genie/dat/UnitPool.h"
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+UnitPool::UnitPool()
+{
+}
+
+//------------------------------------------------------------------------------
+UnitPool::~UnitPool()
+{
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<Unit> UnitPool::intern(Unit &unit)
+{
+    key_.buffer()->clear();
+    unit.writeObject(key_);
+
+    std::string key(key_.buffer()->data(), key_.buffer()->size());
+    std::shared_ptr<Unit> &pooled = units_[std::move(key)];
+
+    if (!pooled)
+        pooled = std::make_shared<Unit>(std::move(unit));
+
+    return pooled;
+}
+
+//------------------------------------------------------------------------------
+size_t UnitPool::size(void) const
+{
+    return units_.size();
+}
+}
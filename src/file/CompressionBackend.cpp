@@ -0,0 +1,383 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "genie/file/CompressionBackend.h"
+
+#include <algorithm>
+#include <limits.h>
+
+#ifdef GUTILS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef GUTILS_HAVE_ZLIB_NG
+#include <zlib-ng.h>
+#endif
+
+#ifdef GUTILS_HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#ifdef GUTILS_HAVE_MINIZ
+#include "../../extern/miniz/miniz.h"
+#endif
+
+namespace genie {
+
+namespace {
+
+/// zlib like libraries take at most this many bytes per call.
+const size_t CHUNK_MAX = UINT_MAX;
+
+//------------------------------------------------------------------------------
+/// Inflates src with a zlib like API described by Api.
+//
+template <typename Api>
+bool inflateStream(const char *src, size_t size, std::vector<char> &dest)
+{
+    typename Api::Stream stream = {};
+
+    if (Api::initInflate(&stream) != Api::OK)
+        return false;
+
+    dest.resize(std::max<size_t>(size * 4, 4096));
+
+    size_t in = 0, out = 0;
+    int ret;
+
+    do {
+        if (out == dest.size())
+            dest.resize(dest.size() * 2);
+
+        size_t in_chunk = std::min(size - in, CHUNK_MAX);
+        size_t out_chunk = std::min(dest.size() - out, CHUNK_MAX);
+
+        stream.next_in = (decltype(stream.next_in))(src + in);
+        stream.avail_in = in_chunk;
+        stream.next_out = (decltype(stream.next_out))(dest.data() + out);
+        stream.avail_out = out_chunk;
+
+        ret = Api::runInflate(&stream, Api::NO_FLUSH);
+
+        in += in_chunk - stream.avail_in;
+        out += out_chunk - stream.avail_out;
+    } while (ret == Api::OK || (ret == Api::BUF_ERROR && out == dest.size()));
+
+    Api::endInflate(&stream);
+    dest.resize(out);
+
+    return ret == Api::STREAM_END;
+}
+
+//------------------------------------------------------------------------------
+/// Deflates src with a zlib like API described by Api.
+//
+template <typename Api>
+bool deflateStream(const char *src, size_t size, int level,
+                   std::vector<char> &dest)
+{
+    typename Api::Stream stream = {};
+
+    if (Api::initDeflate(&stream, level) != Api::OK)
+        return false;
+
+    // Enough for stored blocks, which add 5 bytes per 64 KiB.
+    dest.resize(size + size / 8192 + 1024);
+
+    size_t in = 0, out = 0;
+    int ret;
+
+    do {
+        if (out == dest.size())
+            dest.resize(dest.size() * 2);
+
+        size_t in_chunk = std::min(size - in, CHUNK_MAX);
+        size_t out_chunk = std::min(dest.size() - out, CHUNK_MAX);
+
+        stream.next_in = (decltype(stream.next_in))(src + in);
+        stream.avail_in = in_chunk;
+        stream.next_out = (decltype(stream.next_out))(dest.data() + out);
+        stream.avail_out = out_chunk;
+
+        ret = Api::runDeflate(&stream, in + in_chunk == size ? Api::FINISH : Api::NO_FLUSH);
+
+        in += in_chunk - stream.avail_in;
+        out += out_chunk - stream.avail_out;
+    } while (ret == Api::OK || (ret == Api::BUF_ERROR && out == dest.size()));
+
+    Api::endDeflate(&stream);
+    dest.resize(out);
+
+    return ret == Api::STREAM_END;
+}
+
+#ifdef GUTILS_HAVE_ZLIB
+//------------------------------------------------------------------------------
+struct ZlibApi {
+    typedef z_stream Stream;
+
+    static const int OK = Z_OK;
+    static const int STREAM_END = Z_STREAM_END;
+    static const int BUF_ERROR = Z_BUF_ERROR;
+    static const int NO_FLUSH = Z_NO_FLUSH;
+    static const int FINISH = Z_FINISH;
+
+    static int initInflate(Stream *s) { return inflateInit2(s, -15); }
+    static int runInflate(Stream *s, int flush) { return ::inflate(s, flush); }
+    static int endInflate(Stream *s) { return ::inflateEnd(s); }
+
+    static int initDeflate(Stream *s, int level)
+    {
+        return deflateInit2(s, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    }
+    static int runDeflate(Stream *s, int flush) { return ::deflate(s, flush); }
+    static int endDeflate(Stream *s) { return ::deflateEnd(s); }
+};
+
+//------------------------------------------------------------------------------
+class ZlibBackend : public CompressionBackend
+{
+public:
+    Type type(void) const override { return ZLIB; }
+    const char *name(void) const override { return "zlib"; }
+    int maxLevel(void) const override { return 9; }
+
+    bool inflateRaw(const char *src, size_t size,
+                    std::vector<char> &dest) const override
+    {
+        return inflateStream<ZlibApi>(src, size, dest);
+    }
+
+    bool deflateRaw(const char *src, size_t size, int level,
+                    std::vector<char> &dest) const override
+    {
+        return deflateStream<ZlibApi>(src, size, std::min(level, maxLevel()), dest);
+    }
+};
+#endif
+
+#ifdef GUTILS_HAVE_ZLIB_NG
+//------------------------------------------------------------------------------
+struct ZlibNgApi {
+    typedef zng_stream Stream;
+
+    static const int OK = Z_OK;
+    static const int STREAM_END = Z_STREAM_END;
+    static const int BUF_ERROR = Z_BUF_ERROR;
+    static const int NO_FLUSH = Z_NO_FLUSH;
+    static const int FINISH = Z_FINISH;
+
+    static int initInflate(Stream *s) { return zng_inflateInit2(s, -15); }
+    static int runInflate(Stream *s, int flush) { return zng_inflate(s, flush); }
+    static int endInflate(Stream *s) { return zng_inflateEnd(s); }
+
+    static int initDeflate(Stream *s, int level)
+    {
+        return zng_deflateInit2(s, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    }
+    static int runDeflate(Stream *s, int flush) { return zng_deflate(s, flush); }
+    static int endDeflate(Stream *s) { return zng_deflateEnd(s); }
+};
+
+//------------------------------------------------------------------------------
+class ZlibNgBackend : public CompressionBackend
+{
+public:
+    Type type(void) const override { return ZLIB_NG; }
+    const char *name(void) const override { return "zlib-ng"; }
+    int maxLevel(void) const override { return 9; }
+
+    bool inflateRaw(const char *src, size_t size,
+                    std::vector<char> &dest) const override
+    {
+        return inflateStream<ZlibNgApi>(src, size, dest);
+    }
+
+    bool deflateRaw(const char *src, size_t size, int level,
+                    std::vector<char> &dest) const override
+    {
+        return deflateStream<ZlibNgApi>(src, size, std::min(level, maxLevel()), dest);
+    }
+};
+#endif
+
+#ifdef GUTILS_HAVE_MINIZ
+//------------------------------------------------------------------------------
+struct MinizApi {
+    typedef mz_stream Stream;
+
+    static const int OK = MZ_OK;
+    static const int STREAM_END = MZ_STREAM_END;
+    static const int BUF_ERROR = MZ_BUF_ERROR;
+    static const int NO_FLUSH = MZ_NO_FLUSH;
+    static const int FINISH = MZ_FINISH;
+
+    static int initInflate(Stream *s) { return mz_inflateInit2(s, -15); }
+    static int runInflate(Stream *s, int flush) { return mz_inflate(s, flush); }
+    static int endInflate(Stream *s) { return mz_inflateEnd(s); }
+
+    static int initDeflate(Stream *s, int level)
+    {
+        return mz_deflateInit2(s, level, MZ_DEFLATED, -15, 8, MZ_DEFAULT_STRATEGY);
+    }
+    static int runDeflate(Stream *s, int flush) { return mz_deflate(s, flush); }
+    static int endDeflate(Stream *s) { return mz_deflateEnd(s); }
+};
+
+//------------------------------------------------------------------------------
+class MinizBackend : public CompressionBackend
+{
+public:
+    Type type(void) const override { return MINIZ; }
+    const char *name(void) const override { return "miniz"; }
+    int maxLevel(void) const override { return 10; }
+
+    bool inflateRaw(const char *src, size_t size,
+                    std::vector<char> &dest) const override
+    {
+        return inflateStream<MinizApi>(src, size, dest);
+    }
+
+    bool deflateRaw(const char *src, size_t size, int level,
+                    std::vector<char> &dest) const override
+    {
+        return deflateStream<MinizApi>(src, size, std::min(level, maxLevel()), dest);
+    }
+};
+#endif
+
+#ifdef GUTILS_HAVE_LIBDEFLATE
+//------------------------------------------------------------------------------
+/// One shot only, which is what makes it fast.
+//
+class LibdeflateBackend : public CompressionBackend
+{
+public:
+    Type type(void) const override { return LIBDEFLATE; }
+    const char *name(void) const override { return "libdeflate"; }
+    int maxLevel(void) const override { return 12; }
+
+    bool inflateRaw(const char *src, size_t size,
+                    std::vector<char> &dest) const override
+    {
+        libdeflate_decompressor *decompressor = libdeflate_alloc_decompressor();
+
+        if (!decompressor)
+            return false;
+
+        dest.resize(std::max<size_t>(size * 4, 4096));
+
+        libdeflate_result result;
+        size_t in_size, out_size = 0;
+
+        // The uncompressed size isn't stored, grow until it fits.
+        while ((result = libdeflate_deflate_decompress_ex(
+                    decompressor, src, size, dest.data(), dest.size(),
+                    &in_size, &out_size))
+               == LIBDEFLATE_INSUFFICIENT_SPACE) {
+            dest.resize(dest.size() * 2);
+        }
+
+        libdeflate_free_decompressor(decompressor);
+        dest.resize(out_size);
+
+        return result == LIBDEFLATE_SUCCESS;
+    }
+
+    bool deflateRaw(const char *src, size_t size, int level,
+                    std::vector<char> &dest) const override
+    {
+        // Older versions don't support level 0.
+        libdeflate_compressor *compressor = libdeflate_alloc_compressor(std::min(level, maxLevel()));
+
+        if (!compressor)
+            return false;
+
+        dest.resize(libdeflate_deflate_compress_bound(compressor, size));
+
+        size_t out_size = libdeflate_deflate_compress(compressor, src, size,
+                                                      dest.data(), dest.size());
+
+        libdeflate_free_compressor(compressor);
+        dest.resize(out_size);
+
+        return out_size > 0;
+    }
+};
+#endif
+}
+
+//------------------------------------------------------------------------------
+const CompressionBackend *CompressionBackend::get(Type type)
+{
+    switch (type) {
+#ifdef GUTILS_HAVE_ZLIB
+    case ZLIB: {
+        static const ZlibBackend backend;
+        return &backend;
+    }
+#endif
+#ifdef GUTILS_HAVE_ZLIB_NG
+    case ZLIB_NG: {
+        static const ZlibNgBackend backend;
+        return &backend;
+    }
+#endif
+#ifdef GUTILS_HAVE_LIBDEFLATE
+    case LIBDEFLATE: {
+        static const LibdeflateBackend backend;
+        return &backend;
+    }
+#endif
+#ifdef GUTILS_HAVE_MINIZ
+    case MINIZ: {
+        static const MinizBackend backend;
+        return &backend;
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+const CompressionBackend *CompressionBackend::getDefault(void)
+{
+    const Type preferred[] = { LIBDEFLATE, ZLIB_NG, ZLIB, MINIZ };
+
+    for (Type type : preferred) {
+        if (const CompressionBackend *backend = get(type))
+            return backend;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+std::vector<CompressionBackend::Type> CompressionBackend::available(void)
+{
+    std::vector<Type> types;
+
+    for (int i = 0; i < TYPE_COUNT; ++i) {
+        if (get(Type(i)))
+            types.push_back(Type(i));
+    }
+
+    return types;
+}
+}
@@ -19,13 +19,201 @@
 
 #include "genie/file/Compressor.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <zstr.hpp>
 
 namespace genie {
 
-Compressor::Compressor()
+namespace {
+
+const std::size_t BLOCK_SIZE = (std::size_t)1 << 20;
+
+//------------------------------------------------------------------------------
+/// Stream buffer handing out data that a second thread inflates into a ring
+/// of blocks, so inflating and reading overlap.
+//
+class InflatePipelineBuffer : public std::streambuf
+{
+public:
+    InflatePipelineBuffer(std::istream &source) :
+        blocks_(BLOCK_COUNT)
+    {
+        for (Block &block : blocks_)
+            block.data.resize(BLOCK_SIZE);
+
+        producer_ = std::thread(&InflatePipelineBuffer::produce, this, std::ref(source));
+    }
+
+    ~InflatePipelineBuffer() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+
+        cond_.notify_all();
+        producer_.join();
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // Hand the block we're done with back to the producer.
+        if (holding_) {
+            readIndex_ = (readIndex_ + 1) % BLOCK_COUNT;
+            --filled_;
+            holding_ = false;
+            cond_.notify_all();
+        }
+
+        cond_.wait(lock, [this] { return filled_ > 0 || finished_; });
+
+        if (filled_ == 0)
+            return traits_type::eof();
+
+        Block &block = blocks_[readIndex_];
+        holding_ = true;
+        lock.unlock();
+
+        setg(block.data.data(), block.data.data(), block.data.data() + block.size);
+
+        if (block.size == 0)
+            return traits_type::eof();
+
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    static const std::size_t BLOCK_COUNT = 4;
+
+    struct Block {
+        std::vector<char> data;
+        std::size_t size = 0;
+    };
+
+    //----------------------------------------------------------------------------
+    void produce(std::istream &source)
+    {
+        try {
+            // Important thing here is window_bits = 15
+            zstr::istream inflated(source, BLOCK_SIZE, false, -15);
+
+            bool last = false;
+
+            while (!last) {
+                std::size_t index;
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cond_.wait(lock, [this] { return stop_ || filled_ < BLOCK_COUNT; });
+
+                    if (stop_)
+                        return;
+
+                    index = writeIndex_;
+                }
+
+                Block &block = blocks_[index];
+                inflated.read(block.data.data(), block.data.size());
+                block.size = inflated.gcount();
+                last = (block.size < block.data.size());
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    writeIndex_ = (writeIndex_ + 1) % BLOCK_COUNT;
+                    ++filled_;
+                    finished_ = last;
+                }
+
+                cond_.notify_all();
+            }
+        } catch (const std::exception &exception) {
+            std::cerr << "Zlib decompression failed with error code: "
+                      << exception.what() << std::endl;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                finished_ = true;
+            }
+
+            cond_.notify_all();
+        }
+    }
+
+    std::vector<Block> blocks_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread producer_;
+
+    std::size_t readIndex_ = 0;
+    std::size_t writeIndex_ = 0;
+    std::size_t filled_ = 0;
+
+    /// The reader currently uses the block at readIndex_.
+    bool holding_ = false;
+    bool finished_ = false;
+    bool stop_ = false;
+};
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+/// Compressed data goes up to the end of the file. Returns it without copying
+/// if source reads from memory, otherwise reads it into storage.
+//
+const char *compressedData(std::istream &source, std::vector<char> &storage,
+                           std::size_t &size)
+{
+    if (const MemoryReadBuffer *in = dynamic_cast<const MemoryReadBuffer *>(source.rdbuf())) {
+        size = in->size() - in->position();
+        return in->data() + in->position();
+    }
+
+    std::istream::pos_type start = source.tellg();
+
+    if (start != std::istream::pos_type(-1) && source.seekg(0, std::ios_base::end)) {
+        storage.reserve(std::size_t(source.tellg() - start));
+        source.seekg(start);
+    }
+    source.clear();
+
+    char buffer[1 << 16];
+
+    while (source.read(buffer, sizeof(buffer)) || source.gcount() > 0)
+        storage.insert(storage.end(), buffer, buffer + source.gcount());
+
+    size = storage.size();
+    return storage.data();
+}
+
+//------------------------------------------------------------------------------
+class InflatePipelineStream : public std::istream
+{
+public:
+    InflatePipelineStream(std::istream &source) :
+        std::istream(nullptr),
+        buffer_(source)
+    {
+        rdbuf(&buffer_);
+    }
+
+private:
+    InflatePipelineBuffer buffer_;
+};
+}
+
+Compressor::Compressor() :
+    obj_(0)
 {
 }
 
@@ -53,7 +241,6 @@ void Compressor::beginCompression(void)
         break;
 
     case ISerializable::OP_WRITE:
-        obj_->setIStream(*istream_);
         ostream_ = obj_->getOStream();
 
         startCompression();
@@ -84,17 +271,67 @@ void Compressor::endCompression(void)
 }
 
 //------------------------------------------------------------------------------
-void Compressor::decompress(std::istream &source, std::ostream &sink)
+std::size_t Compressor::decompress(std::istream &source, std::ostream &sink,
+                                   const CompressionBackend *backend)
+{
+    std::vector<char> compressed;
+    std::size_t size;
+    const char *src = compressedData(source, compressed, size);
+
+    std::vector<char> data;
+
+    if (backend && backend->inflateRaw(src, size, data)) {
+        sink.write(data.data(), data.size());
+        return sink ? data.size() : 0;
+    }
+
+    // No backend or it rejected the data, zstr reports what is wrong with it.
+    std::size_t written = 0;
+
+    try {
+        MemoryIStream in(src, size);
+        zstr::istream inflated(in, BLOCK_SIZE, false, -15);
+
+        data.resize(BLOCK_SIZE);
+
+        while ((inflated.read(data.data(), data.size()) || inflated.gcount() > 0) && sink) {
+            sink.write(data.data(), inflated.gcount());
+            written += inflated.gcount();
+        }
+    } catch (const std::exception &exception) {
+        std::cerr << "Zlib decompression failed with error code: "
+                  << exception.what() << std::endl;
+    }
+
+    return written;
+}
+
+//------------------------------------------------------------------------------
+bool Compressor::setCompressionBackend(CompressionBackend::Type type)
 {
-    Compressor cmp;
+    const CompressionBackend *backend = CompressionBackend::get(type);
 
-    cmp.istream_ = &source;
-    cmp.startDecompression();
+    if (!backend)
+        return false;
 
-    while (!cmp.uncompressedIstream_->eof() && sink.good()) {
-        char buffer[4096];
-        source.get(buffer, sizeof buffer);
-        sink.write(buffer, source.gcount());
+    backend_ = backend;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void Compressor::setCompressionProfile(CompressionProfile profile)
+{
+    switch (profile) {
+    case COMPRESSION_FAST:
+        level_ = 1;
+        break;
+    case COMPRESSION_MAX:
+        level_ = MAX_LEVEL;
+        break;
+    default:
+        level_ = 0;
+        break;
     }
 }
 
@@ -102,9 +339,35 @@ void Compressor::decompress(std::istream &source, std::ostream &sink)
 void Compressor::startDecompression(void)
 {
     try {
-        // Important thing here is window_bits = 15
-        uncompressedIstream_ = std::make_shared<zstr::istream>(*istream_, (std::size_t)1 << 20, false, -15);
-    } catch (const zstr::Exception &exception) {
+        switch (decompressionMode_) {
+        case DECOMPRESS_IN_MEMORY: {
+            std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>();
+
+            std::vector<char> compressed;
+            std::size_t size;
+            const char *src = compressedData(*istream_, compressed, size);
+
+            if (!backend_ || !backend_->inflateRaw(src, size, *data)) {
+                std::cerr << "Zlib decompression failed with "
+                          << (backend_ ? backend_->name() : "no backend") << std::endl;
+            }
+
+            std::shared_ptr<MemoryIStream> stream = std::make_shared<MemoryIStream>(data->data(), data->size());
+            stream->buffer()->setOwner(data);
+            uncompressedIstream_ = stream;
+            break;
+        }
+
+        case DECOMPRESS_PIPELINED:
+            uncompressedIstream_ = std::make_shared<InflatePipelineStream>(*istream_);
+            break;
+
+        default:
+            // Important thing here is window_bits = 15
+            uncompressedIstream_ = std::make_shared<zstr::istream>(*istream_, BLOCK_SIZE, false, -15);
+            break;
+        }
+    } catch (const std::exception &exception) {
         uncompressedIstream_.reset();
         std::cerr << "Zlib decompression failed with error code: "
                   << exception.what() << std::endl;
@@ -114,30 +377,45 @@ void Compressor::startDecompression(void)
 //------------------------------------------------------------------------------
 void Compressor::stopDecompression(void)
 {
+    // A pipeline thread has to be done with istream_ before it's used again.
+    uncompressedIstream_.reset();
+
     obj_->setIStream(*istream_);
     istream_ = 0;
-
-    uncompressedIstream_.reset();
 }
 
 //------------------------------------------------------------------------------
 void Compressor::startCompression(void)
 {
-    try {
-        // Important thing here is window_bits = 15
-        bufferedStream_ = std::make_shared<zstr::ostream>(*ostream_, (std::size_t)1 << 20, false, -15);
-    } catch (const zstr::Exception &exception) {
-        bufferedStream_.reset();
-        std::cerr << "Zlib compression failed with error code: "
-                  << exception.what() << std::endl;
-    }
+    if (bufferedStream_)
+        bufferedStream_->buffer()->clear();
+    else
+        bufferedStream_ = std::make_shared<MemoryOStream>(BLOCK_SIZE);
 }
 
 //------------------------------------------------------------------------------
 void Compressor::stopCompression(void)
 {
+    // Everything is compressed at once, so zlib gets large blocks instead of
+    // single fields.
+    const MemoryWriteBuffer *data = bufferedStream_->buffer();
+    std::vector<char> compressed;
+
+    if (backend_ && backend_->deflateRaw(data->data(), data->size(), level_, compressed)) {
+        ostream_->write(compressed.data(), compressed.size());
+    } else {
+        try {
+            // Important thing here is window_bits = 15
+            zstr::ostream deflated(*ostream_, BLOCK_SIZE, std::min(level_, 9), -15);
+            deflated.write(data->data(), data->size());
+        } catch (const zstr::Exception &exception) {
+            std::cerr << "Zlib compression failed with error code: "
+                      << exception.what() << std::endl;
+        }
+    }
+
+    obj_->setOStream(*ostream_);
     ostream_ = 0;
-    bufferedStream_.reset();
 }
 }
 
@@ -19,6 +19,13 @@
 */
 
 #include "genie/file/IFile.h"
+#include "genie/file/MappedFile.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 namespace genie {
 
@@ -30,13 +37,17 @@ IFile::IFile()
 //------------------------------------------------------------------------------
 IFile::~IFile()
 {
-    fileIn_.close();
+    freelock();
 }
 
 //------------------------------------------------------------------------------
 void IFile::freelock(void)
 {
     fileIn_.close();
+
+    // Objects that still point into the mapping keep it alive.
+    mappedIn_.reset();
+    mapping_.reset();
 }
 
 //------------------------------------------------------------------------------
@@ -51,6 +62,12 @@ const char *IFile::getFileName(void) const
     return fileName_.c_str();
 }
 
+//------------------------------------------------------------------------------
+void IFile::setMemoryMapped(bool mapped)
+{
+    memoryMapped_ = mapped;
+}
+
 //------------------------------------------------------------------------------
 void IFile::load()
 {
@@ -67,6 +84,17 @@ void IFile::load(std::string fileName)
 
     fileName_ = fileName;
 
+    if (memoryMapped_) {
+        mapping_ = std::make_shared<MappedFile>(fileName_);
+
+        mappedIn_.reset(new MemoryIStream(mapping_->data(), mapping_->size()));
+        mappedIn_->buffer()->setOwner(mapping_);
+
+        readObject(*mappedIn_);
+        loaded_ = true;
+        return;
+    }
+
     fileIn_.open(fileName, std::ios::binary | std::ios::in);
 
     if (fileIn_.fail()) {
@@ -90,17 +118,41 @@ void IFile::save()
 //------------------------------------------------------------------------------
 void IFile::saveAs(const char *fileName)
 {
+    // Serialize to memory first and write the file in one go.
+    MemoryOStream data;
+    writeObject(data);
+
+    writeFile(fileName, data.buffer()->data(), data.buffer()->size());
+}
+
+//------------------------------------------------------------------------------
+void IFile::writeFile(const char *fileName, const char *data, size_t size)
+{
+    std::string tmpName = std::string(fileName) + ".tmp";
     std::ofstream file;
 
-    file.open(fileName, std::ofstream::binary);
+    file.open(tmpName, std::ofstream::binary);
 
-    if (file.fail()) {
+    if (!file.fail()) {
+        file.write(data, size);
         file.close();
+    }
+
+    if (file.fail()) {
+        std::remove(tmpName.c_str());
         throw std::ios_base::failure("Cant write to file: \"" + std::string(fileName) + "\"");
-    } else
-        writeObject(file);
+    }
 
-    file.close();
+#ifdef _WIN32
+    bool renamed = MoveFileExA(tmpName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING);
+#else
+    bool renamed = std::rename(tmpName.c_str(), fileName) == 0;
+#endif
+
+    if (!renamed) {
+        std::remove(tmpName.c_str());
+        throw std::ios_base::failure("Cant write to file: \"" + std::string(fileName) + "\"");
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 
 #include "genie/file/ISerializable.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace genie {
@@ -28,18 +29,33 @@ namespace genie {
 void ISerializable::readObject(std::istream &istr)
 {
     setOperation(OP_READ);
-    istr_ = &istr;
+    setIStream(istr);
+
+    ContextScope scope(*this, nullptr);
 
     istr_->seekg(init_read_pos_);
 
     serializeObject();
 }
 
+//------------------------------------------------------------------------------
+void ISerializable::readObject(const char *data, size_t size)
+{
+    MemoryIStream istr(data, size);
+
+    readObject(istr);
+
+    resetIStream();
+}
+
 //------------------------------------------------------------------------------
 void ISerializable::writeObject(std::ostream &ostr)
 {
     setOperation(OP_WRITE);
-    ostr_ = &ostr;
+    setOStream(ostr);
+
+    ContextScope scope(*this, nullptr);
+
     serializeObject();
 }
 
@@ -49,6 +65,9 @@ size_t ISerializable::objectSize(void)
     size_ = 0;
 
     setOperation(OP_CALC_SIZE);
+
+    ContextScope scope(*this, nullptr);
+
     serializeObject();
 
     return size_;
@@ -58,9 +77,22 @@ size_t ISerializable::objectSize(void)
 void ISerializable::serializeSubObject(ISerializable *const other)
 {
     istr_ = other->istr_;
+    ibuf_ = other->ibuf_;
     ostr_ = other->ostr_;
+    obuf_ = other->obuf_;
     operation_ = other->operation_;
+
+    // Bound only while serializing, the root and its context may be gone
+    // afterwards.
+    ContextScope scope(*this, &other->context());
+
     setGameVersion(other->gameVersion_);
+
+    // The parent adds our size after we're done, so sizes of the subtree are
+    // only computed once.
+    if (operation_ == OP_CALC_SIZE)
+        size_ = 0;
+
     serializeObject();
 }
 
@@ -91,36 +123,45 @@ std::streampos ISerializable::tellg(void) const
 //------------------------------------------------------------------------------
 std::string ISerializable::readString(size_t len)
 {
-    if (len > 0 && !istr_->eof()) {
-        char *buf = 0;
-        serialize<char>(&buf, len);
+    std::string ret;
+    readString(ret, len);
 
-        size_t tmp_len = ISerializable::strnlen(buf, len);
+    return ret;
+}
 
-        if (tmp_len < len)
-            len = tmp_len;
+//------------------------------------------------------------------------------
+void ISerializable::readString(std::string &str, size_t len)
+{
+    if (len == 0 || istr_->eof()) {
+        str.clear();
+        return;
+    }
 
-        std::string ret(buf, len);
-        delete[] buf;
+    const char *src = ibuf_ ? ibuf_->take(len) : 0;
 
-        return ret;
+    if (src) {
+        str.assign(src, ISerializable::strnlen(src, len));
+    } else {
+        str.resize(len);
+        istr_->read(&str[0], len);
+        str.resize(ISerializable::strnlen(str.data(), len));
     }
-
-    return "";
 }
 
 //------------------------------------------------------------------------------
-void ISerializable::writeString(std::string str, size_t len)
+void ISerializable::writeString(const std::string &str, size_t len)
 {
-    char *buf = new char[len];
+    static const char zeros[64] = {};
 
-    strncpy(buf, str.c_str(), len);
+    size_t str_len = ISerializable::strnlen(str.c_str(), std::min(str.size(), len));
 
-    for (unsigned int i = str.size(); i < len; i++)
-        buf[i] = 0; // fill up with 0
+    writeBytes(str.data(), str_len);
 
-    ostr_->write(buf, len);
-
-    delete[] buf;
+    // fill up with 0
+    for (size_t left = len - str_len; left > 0;) {
+        size_t chunk = std::min(left, sizeof(zeros));
+        writeBytes(zeros, chunk);
+        left -= chunk;
+    }
 }
 }
@@ -0,0 +1,126 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "genie/file/MappedFile.h"
+
+#include <ios>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace genie {
+
+#ifdef _WIN32
+
+//------------------------------------------------------------------------------
+MappedFile::MappedFile(const std::string &fileName)
+{
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::ios_base::failure("Cant read file: \"" + fileName + "\"");
+
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::ios_base::failure("Cant read file: \"" + fileName + "\"");
+    }
+
+    size_ = size_t(fileSize.QuadPart);
+
+    // Empty files can't be mapped
+    if (size_ == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    mappingHandle_ = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+
+    if (!mappingHandle_)
+        throw std::ios_base::failure("Cant map file: \"" + fileName + "\"");
+
+    data_ = static_cast<const char *>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+
+    if (!data_) {
+        CloseHandle(mappingHandle_);
+        throw std::ios_base::failure("Cant map file: \"" + fileName + "\"");
+    }
+}
+
+//------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    if (data_)
+        UnmapViewOfFile(data_);
+
+    if (mappingHandle_)
+        CloseHandle(mappingHandle_);
+}
+
+#else
+
+//------------------------------------------------------------------------------
+MappedFile::MappedFile(const std::string &fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        throw std::ios_base::failure("Cant read file: \"" + fileName + "\"");
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::ios_base::failure("Cant read file: \"" + fileName + "\"");
+    }
+
+    size_ = size_t(st.st_size);
+
+    // Empty files can't be mapped
+    if (size_ == 0) {
+        close(fd);
+        return;
+    }
+
+    void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+        throw std::ios_base::failure("Cant map file: \"" + fileName + "\"");
+
+    data_ = static_cast<const char *>(mapping);
+}
+
+//------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    if (data_)
+        munmap(const_cast<char *>(data_), size_);
+}
+
+#endif
+}
@@ -0,0 +1,137 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "genie/file/MemoryStream.h"
+
+#include <algorithm>
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+MemoryReadBuffer::MemoryReadBuffer(const char *data, size_t size)
+{
+    char *begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+}
+
+//------------------------------------------------------------------------------
+std::streamsize MemoryReadBuffer::xsgetn(char *dest, std::streamsize count)
+{
+    std::streamsize available = egptr() - gptr();
+    std::streamsize len = std::min(count, available);
+
+    if (len > 0) {
+        memcpy(dest, gptr(), len);
+        setg(eback(), gptr() + len, egptr());
+    }
+
+    return len;
+}
+
+//------------------------------------------------------------------------------
+MemoryReadBuffer::pos_type MemoryReadBuffer::seekoff(off_type off,
+                                                     std::ios_base::seekdir dir,
+                                                     std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in))
+        return pos_type(off_type(-1));
+
+    off_type base;
+
+    switch (dir) {
+    case std::ios_base::beg:
+        base = 0;
+        break;
+    case std::ios_base::cur:
+        base = gptr() - eback();
+        break;
+    case std::ios_base::end:
+        base = egptr() - eback();
+        break;
+    default:
+        return pos_type(off_type(-1));
+    }
+
+    off_type target = base + off;
+
+    if (target < 0 || target > egptr() - eback())
+        return pos_type(off_type(-1));
+
+    setg(eback(), eback() + target, egptr());
+
+    return pos_type(target);
+}
+
+//------------------------------------------------------------------------------
+MemoryReadBuffer::pos_type MemoryReadBuffer::seekpos(pos_type pos,
+                                                     std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+//------------------------------------------------------------------------------
+MemoryIStream::MemoryIStream(const char *data, size_t size) :
+    std::istream(nullptr),
+    buffer_(data, size)
+{
+    rdbuf(&buffer_);
+}
+
+//------------------------------------------------------------------------------
+MemoryWriteBuffer::MemoryWriteBuffer(size_t reserve)
+{
+    data_.reserve(reserve);
+}
+
+//------------------------------------------------------------------------------
+std::streamsize MemoryWriteBuffer::xsputn(const char *src, std::streamsize count)
+{
+    write(src, count);
+
+    return count;
+}
+
+//------------------------------------------------------------------------------
+MemoryWriteBuffer::int_type MemoryWriteBuffer::overflow(int_type c)
+{
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+        data_.push_back(traits_type::to_char_type(c));
+
+    return traits_type::not_eof(c);
+}
+
+//------------------------------------------------------------------------------
+MemoryWriteBuffer::pos_type MemoryWriteBuffer::seekoff(off_type off,
+                                                       std::ios_base::seekdir dir,
+                                                       std::ios_base::openmode which)
+{
+    // Only telling the position is supported, data is always appended.
+    if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out))
+        return pos_type(off_type(-1));
+
+    return pos_type(off_type(data_.size()));
+}
+
+//------------------------------------------------------------------------------
+MemoryOStream::MemoryOStream(size_t reserve) :
+    std::ostream(nullptr),
+    buffer_(reserve)
+{
+    rdbuf(&buffer_);
+}
+}
@@ -19,10 +19,15 @@
 
 #include "genie/resource/DrsFile.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <thread>
 
 #include "genie/util/Logger.h"
 #include "genie/file/ISerializable.h"
+#include "genie/file/MemoryStream.h"
+#include "genie/resource/ResourceCache.h"
 
 //#include <file/BinaFile.h>
 
@@ -33,7 +38,8 @@ using std::string;
 Logger &DrsFile::log = Logger::getLogger("freeaoe.DrsFile");
 
 //------------------------------------------------------------------------------
-DrsFile::DrsFile()
+DrsFile::DrsFile() :
+    archive_id_(ResourceCache::newArchiveId())
 {
 }
 
@@ -42,16 +48,106 @@ DrsFile::~DrsFile()
 {
 }
 
+//------------------------------------------------------------------------------
+void DrsFile::setConcurrentAccess(bool concurrent)
+{
+    concurrent_ = concurrent;
+
+    if (concurrent)
+        setMemoryMapped(true);
+}
+
+//------------------------------------------------------------------------------
+std::istream *DrsFile::resourceStream(std::unique_ptr<MemoryIStream> &own)
+{
+    MemoryReadBuffer *buffer = getIBuffer();
+
+    if (!concurrent_ || !buffer)
+        return getIStream();
+
+    own.reset(new MemoryIStream(buffer->data(), buffer->size()));
+
+    // Lets slp files point into the mapping instead of copying their data.
+    own->buffer()->setOwner(buffer->owner());
+
+    return own.get();
+}
+
+//------------------------------------------------------------------------------
+void DrsFile::setResourceCache(std::shared_ptr<ResourceCache> cache)
+{
+    cache_ = cache;
+}
+
+//------------------------------------------------------------------------------
+SlpFilePtr DrsFile::readSlpFile(uint32_t id)
+{
+    std::unique_ptr<MemoryIStream> own;
+    SlpFilePtr slp;
+
+    auto i = slp_map_.find(id);
+
+    if (i != slp_map_.end()) {
+        slp.reset(new SlpFile(slp_sizes_.at(id)));
+        slp->setInitialReadPosition(i->second->getInitialReadPosition());
+    } else {
+        auto b = bina_map_.find(id);
+
+        if (b == bina_map_.end()) {
+            log.debug("No slp file with id [%u] found!", id);
+            return slp;
+        }
+
+        slp.reset(new SlpFile(b->second->size()));
+        slp->setInitialReadPosition(b->second->getInitialReadPosition());
+    }
+
+#ifndef NDEBUG
+    log.debug("Loading SLP file [%u] into cache", id);
+#endif
+    slp->readObject(*resourceStream(own));
+
+    return slp;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<PalFile> DrsFile::readPalFile(uint32_t id)
+{
+    auto b = bina_map_.find(id);
+
+    if (b == bina_map_.end()) {
+        log.debug("No bina file with id [%u] found!", id);
+        return nullptr;
+    }
+
+    std::unique_ptr<MemoryIStream> own;
+    return b->second->readPalFile(resourceStream(own));
+}
+
 //------------------------------------------------------------------------------
 SlpFilePtr DrsFile::getSlpFile(uint32_t id)
 {
+    if (cache_) {
+        return cache_->getSlpFile(archive_id_, id, [&] {
+            return readSlpFile(id);
+        });
+    }
+
+    std::unique_ptr<MemoryIStream> own;
     auto i = slp_map_.find(id);
 
     if (i != slp_map_.end()) {
 #ifndef NDEBUG
         log.debug("Loading SLP file [%u]", id);
 #endif
-        i->second->readObject(*getIStream());
+        if (concurrent_) {
+            std::call_once(slp_loaded_.at(id), [&] {
+                i->second->readObject(*resourceStream(own));
+            });
+        } else {
+            i->second->readObject(*getIStream());
+        }
+
         return i->second;
     } else {
         auto i = bina_map_.find(id);
@@ -64,7 +160,7 @@ SlpFilePtr DrsFile::getSlpFile(uint32_t id)
 
             slp->setInitialReadPosition(i->second->getInitialReadPosition());
 
-            slp->readObject(*getIStream());
+            slp->readObject(*resourceStream(own));
 
             return slp;
         } else {
@@ -74,9 +170,106 @@ SlpFilePtr DrsFile::getSlpFile(uint32_t id)
     }
 }
 
+//------------------------------------------------------------------------------
+std::future<std::vector<SlpFilePtr>> DrsFile::prefetchSlpFiles(std::vector<uint32_t> ids,
+                                                               bool decodeFrames,
+                                                               unsigned threads)
+{
+    // Indexes into ids, sorted by position in the file.
+    std::vector<std::pair<std::streamoff, size_t>> order;
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        auto slp = slp_map_.find(ids[i]);
+
+        if (slp != slp_map_.end()) {
+            order.emplace_back(slp->second->getInitialReadPosition(), i);
+            continue;
+        }
+
+        auto bina = bina_map_.find(ids[i]);
+
+        if (bina != bina_map_.end())
+            order.emplace_back(bina->second->getInitialReadPosition(), i);
+    }
+
+    std::sort(order.begin(), order.end());
+
+    unsigned threadCount = threads ? threads : std::thread::hardware_concurrency();
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, order.size()));
+
+    // Reads through the shared stream can't overlap.
+    if (!concurrent_)
+        threadCount = 1;
+
+    auto load = [this, ids, order, decodeFrames, threadCount]() {
+        std::vector<SlpFilePtr> files(ids.size());
+
+        std::atomic<size_t> next(0);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        auto work = [&]() {
+            for (size_t task = next++; task < order.size(); task = next++) {
+                try {
+                    size_t i = order[task].second;
+                    files[i] = getSlpFile(ids[i]);
+
+                    if (decodeFrames && files[i]) {
+                        for (uint32_t frame = 0; frame < files[i]->getFrameCount(); ++frame)
+                            files[i]->getFrame(frame);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(threadCount);
+
+        // If no more threads can be started, this one does the remaining
+        // tasks. Started workers are joined below in any case.
+        try {
+            for (unsigned i = 1; i < threadCount; ++i)
+                workers.emplace_back(work);
+        } catch (...) {
+        }
+
+        work();
+
+        for (std::thread &worker : workers)
+            worker.join();
+
+        if (error)
+            std::rethrow_exception(error);
+
+        return files;
+    };
+
+    if (concurrent_)
+        return std::async(std::launch::async, load);
+
+    std::promise<std::vector<SlpFilePtr>> loaded;
+
+    try {
+        loaded.set_value(load());
+    } catch (...) {
+        loaded.set_exception(std::current_exception());
+    }
+
+    return loaded.get_future();
+}
+
 //------------------------------------------------------------------------------
 const PalFile &DrsFile::getPalFile(uint32_t id)
 {
+    std::unique_lock<std::mutex> lock(cache_mutex_, std::defer_lock);
+
+    if (concurrent_)
+        lock.lock();
+
     auto i = pal_files_.find(id);
 
     if (i != pal_files_.end()) {
@@ -89,16 +282,45 @@ const PalFile &DrsFile::getPalFile(uint32_t id)
         return PalFile::null;
     }
 
-    pal_files_[id] = b->second->readPalFile(getIStream());
+    std::unique_ptr<MemoryIStream> own;
+    pal_files_[id] = b->second->readPalFile(resourceStream(own));
     return *pal_files_.find(id)->second;
 }
 
+//------------------------------------------------------------------------------
+std::shared_ptr<PalFile> DrsFile::getPalFilePtr(uint32_t id)
+{
+    if (cache_) {
+        return cache_->getPalFile(archive_id_, id, [&] {
+            return readPalFile(id);
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(cache_mutex_, std::defer_lock);
+
+    if (concurrent_)
+        lock.lock();
+
+    auto i = pal_files_.find(id);
+
+    if (i != pal_files_.end())
+        return i->second;
+
+    std::shared_ptr<PalFile> pal = readPalFile(id);
+
+    if (pal)
+        pal_files_[id] = pal;
+
+    return pal;
+}
+
 UIFilePtr DrsFile::getUIFile(uint32_t id)
 {
     auto i = bina_map_.find(id);
 
     if (i != bina_map_.end()) {
-        return i->second->readUIFile(getIStream());
+        std::unique_ptr<MemoryIStream> own;
+        return i->second->readUIFile(resourceStream(own));
     } else {
         log.debug("No bina file with id [%u] found!", id);
         return UIFilePtr();
@@ -143,7 +365,8 @@ BmpFilePtr DrsFile::getBmpFile(uint32_t id)
     auto i = bina_map_.find(id);
 
     if (i != bina_map_.end()) {
-        return i->second->readBmpFile(getIStream());
+        std::unique_ptr<MemoryIStream> own;
+        return i->second->readBmpFile(resourceStream(own));
     } else {
         log.debug("No bina file with id [%u] found!", id);
         return BmpFilePtr();
@@ -155,7 +378,8 @@ std::string DrsFile::getScriptFile(uint32_t id)
     auto i = bina_map_.find(id);
 
     if (i != bina_map_.end()) {
-        return i->second->readScriptFile(getIStream());
+        std::unique_ptr<MemoryIStream> own;
+        return i->second->readScriptFile(resourceStream(own));
     } else {
         log.debug("No bina file with id [%u] found!", id);
         return std::string();
@@ -167,7 +391,8 @@ ScnFilePtr DrsFile::getScnFile(uint32_t id)
     auto i = bina_map_.find(id);
 
     if (i != bina_map_.end()) {
-        return i->second->readScnFile(getIStream());
+        std::unique_ptr<MemoryIStream> own;
+        return i->second->readScnFile(resourceStream(own));
     } else {
         log.debug("No bina file with id [%u] found!", id);
         return ScnFilePtr();
@@ -191,7 +416,8 @@ std::string DrsFile::idType(uint32_t id)
         return "unknown";
     }
 
-    return i->second->filetype(getIStream());
+    std::unique_ptr<MemoryIStream> own;
+    return i->second->filetype(resourceStream(own));
 }
 
 //------------------------------------------------------------------------------
@@ -200,22 +426,27 @@ std::shared_ptr<uint8_t> DrsFile::getWavPtr(uint32_t id)
     auto i = wav_offsets_.find(id);
 
     if (i != wav_offsets_.end()) {
-        // FIXME: this gets cleared when it loads the next
-        getIStream()->seekg(std::streampos(i->second));
-        /*uint32_t type =*/ read<uint32_t>();
-        uint32_t size = read<uint32_t>();
+        std::unique_ptr<MemoryIStream> own;
+        std::istream *istr = resourceStream(own);
+
+        // RIFF header: type and size of the data following it
+        uint32_t header[2] = { 0, 0 };
+        istr->seekg(std::streampos(i->second));
+        istr->read(reinterpret_cast<char *>(header), sizeof(header));
+        uint32_t size = header[1];
         if (!size)  {
+            istr->clear();
             return nullptr;
         }
 #ifndef NDEBUG
-//        log.debug("WAV [%u], type [%X], size [%u]", id, type, size);
+//        log.debug("WAV [%u], type [%X], size [%u]", id, header[0], size);
 #endif
-        getIStream()->seekg(std::streampos(i->second));
-        std::shared_ptr<uint8_t> ptr ((uint8_t*)::operator new (size + 32));
-        uint8_t *data = ptr.get();
-        for (uint32_t i=0; i<size; i++) {
-            data[i] = read<uint8_t>();
-        }
+        istr->seekg(std::streampos(i->second));
+        // Header included, padded with zeros.
+        size += sizeof(header);
+        std::shared_ptr<uint8_t> ptr(new uint8_t[size + 32](), std::default_delete<uint8_t[]>());
+        istr->read(reinterpret_cast<char *>(ptr.get()), size);
+        istr->clear();
         return ptr;
     } else {
         log.warn("No sound file with id [%u] found!", id);
@@ -223,6 +454,53 @@ std::shared_ptr<uint8_t> DrsFile::getWavPtr(uint32_t id)
     }
 }
 
+//------------------------------------------------------------------------------
+WavData DrsFile::getWav(uint32_t id)
+{
+    WavData wav;
+    auto i = wav_offsets_.find(id);
+
+    if (i == wav_offsets_.end()) {
+        log.warn("No sound file with id [%u] found!", id);
+        return wav;
+    }
+
+    uint32_t pos = i->second;
+    uint32_t size = wav_sizes_.at(id);
+    MemoryReadBuffer *buffer = getIBuffer();
+
+    if (buffer && buffer->owner()) {
+        if (pos > buffer->size() || size > buffer->size() - pos) {
+            log.warn("Sound file [%u] exceeds the file!", id);
+            return wav;
+        }
+
+        wav.data = std::shared_ptr<const uint8_t>(
+            buffer->owner(), reinterpret_cast<const uint8_t *>(buffer->data()) + pos);
+    } else {
+        std::shared_ptr<uint8_t> copy(new uint8_t[size], std::default_delete<uint8_t[]>());
+        std::unique_ptr<MemoryIStream> own;
+        std::istream *istr = resourceStream(own);
+
+        istr->seekg(std::streampos(pos));
+
+        if (!istr->read(reinterpret_cast<char *>(copy.get()), size)) {
+            istr->clear();
+            log.warn("Sound file [%u] exceeds the file!", id);
+            return wav;
+        }
+
+        wav.data = copy;
+    }
+
+    wav.size = size;
+
+    if (!wav.parse())
+        log.warn("Sound file [%u] isn't a wav file", id);
+
+    return wav;
+}
+
 std::vector<uint32_t> DrsFile::binaryFileIds() const
 {
     std::vector<uint32_t> ret;
@@ -243,6 +521,16 @@ std::vector<uint32_t> DrsFile::slpFileIds() const
     return ret;
 }
 
+std::vector<uint32_t> DrsFile::wavFileIds() const
+{
+    std::vector<uint32_t> ret;
+    for (const std::pair<const uint32_t, uint32_t> &entry : wav_offsets_) {
+        ret.push_back(entry.first);
+    }
+
+    return ret;
+}
+
 //------------------------------------------------------------------------------
 void DrsFile::serializeObject(void)
 {
@@ -317,6 +605,10 @@ void DrsFile::loadHeader()
                     slp->setInitialReadPosition(pos);
 
                     slp_map_[id] = slp;
+                    slp_sizes_[id] = len;
+
+                    if (concurrent_)
+                        slp_loaded_[id];
                 } else if (table_types_[i].compare(getBinaryTableHeader()) == 0) {
                     BinaFilePtr bina(new BinaFile(len));
                     bina->setInitialReadPosition(pos);
@@ -324,6 +616,7 @@ void DrsFile::loadHeader()
                     bina_map_[id] = bina;
                 } else if (table_types_[i].compare(getSoundTableHeader()) == 0) {
                     wav_offsets_[id] = pos;
+                    wav_sizes_[id] = len;
                 } else {
                     std::cerr << "unknown header " << std::hex << table_types_[i] << std::dec << std::endl;
                     return;
@@ -0,0 +1,406 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "genie/resource/DrsWriter.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <set>
+
+namespace genie {
+
+namespace {
+
+/// Table types as stored in the file, by DrsWriter::Table.
+const char *const TABLE_TYPES[DrsWriter::TABLE_COUNT] = { "anib", " pls", " vaw" };
+
+/// Copyright, version and file type.
+const size_t HEADER_STRINGS_SIZE = 4 + 12;
+
+/// Number of tables and position of the first payload.
+const size_t HEADER_FIELDS_SIZE = 4 + 4;
+
+/// Type, position and entry count of a table; id, position and size of an
+/// entry.
+const size_t TABLE_SIZE = 12;
+const size_t ENTRY_SIZE = 12;
+}
+
+//------------------------------------------------------------------------------
+DrsWriter::DrsWriter()
+{
+}
+
+//------------------------------------------------------------------------------
+DrsWriter::~DrsWriter()
+{
+}
+
+//------------------------------------------------------------------------------
+void DrsWriter::setResource(Table table, uint32_t id, std::vector<char> data)
+{
+    if (table >= TABLE_COUNT)
+        throw std::invalid_argument("Invalid drs table");
+
+    resources_[ResourceKey(table, id)] = std::move(data);
+}
+
+//------------------------------------------------------------------------------
+bool DrsWriter::removeResource(Table table, uint32_t id)
+{
+    return resources_.erase(ResourceKey(table, id)) > 0;
+}
+
+//------------------------------------------------------------------------------
+bool DrsWriter::hasResource(Table table, uint32_t id) const
+{
+    return resources_.find(ResourceKey(table, id)) != resources_.end();
+}
+
+//------------------------------------------------------------------------------
+const std::vector<char> &DrsWriter::getResource(Table table, uint32_t id) const
+{
+    return resources_.at(ResourceKey(table, id));
+}
+
+//------------------------------------------------------------------------------
+std::vector<uint32_t> DrsWriter::resourceIds(Table table) const
+{
+    std::vector<uint32_t> ids;
+
+    for (auto it = resources_.lower_bound(ResourceKey(table, 0));
+         it != resources_.end() && it->first.first == table; ++it) {
+        ids.push_back(it->first.second);
+    }
+
+    return ids;
+}
+
+//------------------------------------------------------------------------------
+void DrsWriter::setAccessOrder(const std::vector<ResourceKey> &keys)
+{
+    access_order_ = keys;
+}
+
+//------------------------------------------------------------------------------
+void DrsWriter::setAlignment(uint32_t alignment, uint32_t minSize)
+{
+    if (alignment == 0)
+        throw std::invalid_argument("Drs payload alignment can't be 0");
+
+    alignment_ = alignment;
+    align_min_size_ = minSize;
+}
+
+//------------------------------------------------------------------------------
+void DrsWriter::append(const char *fileName)
+{
+    std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+
+    if (file.fail())
+        throw std::ios_base::failure("Cant open file: \"" + std::string(fileName) + "\"");
+
+    // Reads and writes the directory of the file, keeping its header.
+    DrsWriter target;
+    target.setGameVersion(getGameVersion());
+    target.setIStream(file);
+    target.setOperation(OP_READ);
+
+    std::vector<Entry> entries = target.readDirectory();
+
+    file.seekg(0, std::ios::end);
+    uint64_t end = file.tellg();
+
+    // Replaced resources are dropped from the directory.
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const Entry &entry) {
+                                     return hasResource(entry.table, entry.id);
+                                 }),
+                  entries.end());
+
+    size_t kept = entries.size();
+
+    for (const ResourceKey &key : payloadOrder())
+        entries.push_back({ key.first, key.second, 0, uint32_t(resources_.at(key).size()) });
+
+    uint32_t dir_size = target.directorySize(entries);
+    end = std::max<uint64_t>(end, dir_size);
+
+    // Payloads in the way of the grown directory.
+    std::vector<std::pair<size_t, std::vector<char>>> moved;
+
+    for (size_t i = 0; i < kept; ++i) {
+        if (entries[i].pos >= dir_size || entries[i].size == 0)
+            continue;
+
+        std::vector<char> data(entries[i].size);
+        file.seekg(entries[i].pos);
+        file.read(data.data(), data.size());
+
+        if (file.fail())
+            throw std::ios_base::failure("Drs resource exceeds the file: \"" + std::string(fileName) + "\"");
+
+        moved.emplace_back(i, std::move(data));
+    }
+
+    target.alignment_ = alignment_;
+    target.align_min_size_ = align_min_size_;
+    target.setOStream(file);
+    target.setOperation(OP_WRITE);
+
+    file.seekp(end);
+
+    for (auto &it : moved)
+        entries[it.first].pos = target.writePayload(end, it.second);
+
+    for (size_t i = kept; i < entries.size(); ++i)
+        entries[i].pos = target.writePayload(end, resources_.at(ResourceKey(entries[i].table, entries[i].id)));
+
+    // Written last, a failure before leaves the old directory intact.
+    file.seekp(0);
+    target.writeDirectory(entries);
+    file.flush();
+
+    if (file.fail())
+        throw std::ios_base::failure("Cant write to file: \"" + std::string(fileName) + "\"");
+}
+
+//------------------------------------------------------------------------------
+size_t DrsWriter::getCopyRightHeaderSize(void) const
+{
+    if (getGameVersion() >= GV_SWGB)
+        return 0x3C;
+    else
+        return 0x28;
+}
+
+//------------------------------------------------------------------------------
+uint32_t DrsWriter::directorySize(const std::vector<Entry> &entries) const
+{
+    bool used[TABLE_COUNT] = {};
+
+    for (const Entry &entry : entries)
+        used[entry.table] = true;
+
+    size_t num_tables = std::count(used, used + TABLE_COUNT, true);
+
+    return getCopyRightHeaderSize() + HEADER_STRINGS_SIZE + HEADER_FIELDS_SIZE
+        + num_tables * TABLE_SIZE + entries.size() * ENTRY_SIZE;
+}
+
+//------------------------------------------------------------------------------
+std::vector<DrsWriter::ResourceKey> DrsWriter::payloadOrder(void) const
+{
+    std::vector<ResourceKey> order;
+    std::set<ResourceKey> placed;
+
+    for (const ResourceKey &key : access_order_) {
+        if (resources_.count(key) && placed.insert(key).second)
+            order.push_back(key);
+    }
+
+    // Related resources have neighbouring ids, resources_ is sorted by table
+    // and id.
+    for (const auto &it : resources_) {
+        if (placed.find(it.first) == placed.end())
+            order.push_back(it.first);
+    }
+
+    return order;
+}
+
+//------------------------------------------------------------------------------
+uint64_t DrsWriter::placePayload(uint64_t end, size_t size) const
+{
+    if (size >= align_min_size_)
+        end = (end + alignment_ - 1) / alignment_ * alignment_;
+
+    if (end + size > UINT32_MAX)
+        throw std::ios_base::failure("Drs file exceeds 4 GiB");
+
+    return end;
+}
+
+//------------------------------------------------------------------------------
+uint32_t DrsWriter::writePayload(uint64_t &end, const std::vector<char> &data)
+{
+    static const char zeros[64] = {};
+
+    uint64_t pos = placePayload(end, data.size());
+
+    for (uint64_t left = pos - end; left > 0;) {
+        size_t chunk = std::min<uint64_t>(left, sizeof(zeros));
+        writeBytes(zeros, chunk);
+        left -= chunk;
+    }
+
+    writeArray(data.data(), data.size());
+    end = pos + data.size();
+
+    return uint32_t(pos);
+}
+
+//------------------------------------------------------------------------------
+std::vector<DrsWriter::Entry> DrsWriter::readDirectory(void)
+{
+    copyright_ = readString(getCopyRightHeaderSize());
+    version_ = readString(4);
+    file_type_ = readString(12);
+
+    uint32_t num_of_tables = read<uint32_t>();
+    read<uint32_t>(); // position of the first payload
+
+    std::vector<Table> tables;
+    std::vector<uint32_t> table_offsets;
+    std::vector<uint32_t> table_num_of_files;
+
+    for (uint32_t i = 0; i < num_of_tables; ++i) {
+        std::string type = readString(4);
+        const char *const *known = std::find(TABLE_TYPES, TABLE_TYPES + TABLE_COUNT, type);
+
+        if (known == TABLE_TYPES + TABLE_COUNT)
+            throw std::ios_base::failure("Unknown drs table type: \"" + type + "\"");
+
+        tables.push_back(Table(known - TABLE_TYPES));
+        table_offsets.push_back(read<uint32_t>());
+        table_num_of_files.push_back(read<uint32_t>());
+    }
+
+    std::vector<Entry> entries;
+
+    for (uint32_t i = 0; i < num_of_tables; ++i) {
+        getIStream()->seekg(table_offsets[i]);
+
+        for (uint32_t j = 0; j < table_num_of_files[i]; ++j) {
+            Entry entry;
+            entry.table = tables[i];
+            entry.id = read<uint32_t>();
+            entry.pos = read<uint32_t>();
+            entry.size = read<uint32_t>();
+
+            entries.push_back(entry);
+        }
+    }
+
+    if (getIStream()->fail())
+        throw std::ios_base::failure("Drs directory exceeds the file");
+
+    return entries;
+}
+
+//------------------------------------------------------------------------------
+void DrsWriter::writeDirectory(std::vector<Entry> entries)
+{
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.table != b.table ? a.table < b.table : a.id < b.id;
+    });
+
+    uint32_t num_of_files[TABLE_COUNT] = {};
+
+    for (const Entry &entry : entries)
+        num_of_files[entry.table]++;
+
+    bool swgb = getGameVersion() >= GV_SWGB;
+
+    if (copyright_.empty())
+        copyright_ = swgb ? "Copyright (c) 2001 LucasArts Entertainment Company LLC\x1a"
+                          : "Copyright (c) 1997 Ensemble Studios.\x1a";
+    if (version_.empty())
+        version_ = "1.00";
+    if (file_type_.empty())
+        file_type_ = swgb ? "swbg" : "tribe";
+
+    writeString(copyright_, getCopyRightHeaderSize());
+    writeString(version_, 4);
+    writeString(file_type_, 12);
+
+    uint32_t num_of_tables = TABLE_COUNT - std::count(num_of_files, num_of_files + TABLE_COUNT, 0);
+    uint32_t first_payload = directorySize(entries);
+
+    write<uint32_t>(num_of_tables);
+    write<uint32_t>(first_payload);
+
+    uint32_t offset = getCopyRightHeaderSize() + HEADER_STRINGS_SIZE + HEADER_FIELDS_SIZE
+        + num_of_tables * TABLE_SIZE;
+
+    for (int table = 0; table < TABLE_COUNT; ++table) {
+        if (num_of_files[table] == 0)
+            continue;
+
+        writeString(TABLE_TYPES[table], 4);
+        write<uint32_t>(offset);
+        write<uint32_t>(num_of_files[table]);
+
+        offset += num_of_files[table] * ENTRY_SIZE;
+    }
+
+    for (Entry &entry : entries) {
+        write<uint32_t>(entry.id);
+        write<uint32_t>(entry.pos);
+        write<uint32_t>(entry.size);
+    }
+}
+
+//------------------------------------------------------------------------------
+void DrsWriter::unload(void)
+{
+    copyright_.clear();
+    version_.clear();
+    file_type_.clear();
+
+    resources_.clear();
+}
+
+//------------------------------------------------------------------------------
+void DrsWriter::serializeObject(void)
+{
+    if (isOperation(OP_READ)) {
+        for (const Entry &entry : readDirectory()) {
+            std::vector<char> &data = resources_[ResourceKey(entry.table, entry.id)];
+            data.resize(entry.size);
+
+            getIStream()->seekg(entry.pos);
+            readArray(data.data(), entry.size);
+
+            if (getIStream()->fail())
+                throw std::ios_base::failure("Drs resource exceeds the file");
+        }
+    } else if (isOperation(OP_WRITE)) {
+        std::vector<Entry> entries;
+
+        for (const ResourceKey &key : payloadOrder())
+            entries.push_back({ key.first, key.second, 0, uint32_t(resources_.at(key).size()) });
+
+        // Positions are known before anything is written.
+        uint64_t end = directorySize(entries);
+
+        for (Entry &entry : entries) {
+            entry.pos = placePayload(end, entry.size);
+            end = entry.pos + entry.size;
+        }
+
+        writeDirectory(entries);
+
+        end = directorySize(entries);
+
+        for (const Entry &entry : entries)
+            writePayload(end, resources_.at(ResourceKey(entry.table, entry.id)));
+    }
+}
+}
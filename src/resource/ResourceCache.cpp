@@ -0,0 +1,257 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "genie/resource/ResourceCache.h"
+
+#include <atomic>
+#include <vector>
+
+namespace genie {
+
+//------------------------------------------------------------------------------
+ResourceCache::ResourceCache(size_t budget) :
+    budget_(budget)
+{
+}
+
+//------------------------------------------------------------------------------
+ResourceCache::~ResourceCache()
+{
+}
+
+//------------------------------------------------------------------------------
+void ResourceCache::setBudget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    budget_ = budget;
+    evict();
+}
+
+//------------------------------------------------------------------------------
+size_t ResourceCache::getBudget(void) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return budget_;
+}
+
+//------------------------------------------------------------------------------
+ResourceCache::Stats ResourceCache::getStats(void) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return stats_;
+}
+
+//------------------------------------------------------------------------------
+SlpFilePtr ResourceCache::getSlpFile(uint64_t archive, uint32_t id,
+                                     const std::function<SlpFilePtr()> &load)
+{
+    Key key = { archive, id, SLP };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (Entry *entry = find(key)) {
+            auto slp = entry->slp;
+            evict();
+            return slp;
+        }
+    }
+
+    // Loaded without the lock, other resources can be used meanwhile.
+    SlpFilePtr slp = load();
+
+    if (!slp)
+        return slp;
+
+    size_t bytes = measure(slp, nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return insert(key, slp, nullptr, bytes).slp;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<PalFile> ResourceCache::getPalFile(uint64_t archive, uint32_t id,
+                                                   const std::function<std::shared_ptr<PalFile>()> &load)
+{
+    Key key = { archive, id, PAL };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (Entry *entry = find(key)) {
+            auto pal = entry->pal;
+            evict();
+            return pal;
+        }
+    }
+
+    std::shared_ptr<PalFile> pal = load();
+
+    if (!pal)
+        return pal;
+
+    size_t bytes = measure(nullptr, pal);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return insert(key, nullptr, pal, bytes).pal;
+}
+
+//------------------------------------------------------------------------------
+void ResourceCache::trim(void)
+{
+    struct Measured {
+        Key key;
+        SlpFilePtr slp;
+        std::shared_ptr<PalFile> pal;
+        size_t bytes;
+    };
+
+    std::vector<Measured> measured;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        measured.reserve(entries_.size());
+
+        for (auto &it : entries_)
+            measured.push_back(Measured{ it.first, it.second.slp, it.second.pal, 0 });
+    }
+
+    // Measuring an slp file locks it, which mustn't happen under the cache
+    // lock.
+    for (Measured &m : measured)
+        m.bytes = measure(m.slp, m.pal);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (Measured &m : measured) {
+        auto it = entries_.find(m.key);
+
+        // Dropped or replaced meanwhile.
+        if (it == entries_.end() || it->second.slp != m.slp || it->second.pal != m.pal)
+            continue;
+
+        stats_.bytes += m.bytes - it->second.bytes;
+        it->second.bytes = m.bytes;
+    }
+
+    // The pointers taken above pinned the entries.
+    measured.clear();
+
+    evict();
+}
+
+//------------------------------------------------------------------------------
+void ResourceCache::clear(void)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    evict(true);
+}
+
+//------------------------------------------------------------------------------
+uint64_t ResourceCache::newArchiveId(void)
+{
+    static std::atomic<uint64_t> next(0);
+
+    return next++;
+}
+
+//------------------------------------------------------------------------------
+ResourceCache::Entry *ResourceCache::find(const Key &key)
+{
+    auto it = entries_.find(key);
+
+    if (it == entries_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+
+    stats_.hits++;
+
+    Entry &entry = it->second;
+    lru_.splice(lru_.begin(), lru_, entry.use);
+
+    return &entry;
+}
+
+//------------------------------------------------------------------------------
+ResourceCache::Entry &ResourceCache::insert(const Key &key, SlpFilePtr slp,
+                                            std::shared_ptr<PalFile> pal,
+                                            size_t bytes)
+{
+    auto it = entries_.find(key);
+
+    if (it != entries_.end())
+        return it->second;
+
+    Entry &entry = entries_[key];
+    entry.slp = slp;
+    entry.pal = pal;
+    entry.bytes = bytes;
+    entry.use = lru_.insert(lru_.begin(), key);
+
+    stats_.entries++;
+    stats_.bytes += bytes;
+
+    // The caller still holds the new entry, so it isn't dropped here.
+    evict();
+
+    return entry;
+}
+
+//------------------------------------------------------------------------------
+size_t ResourceCache::measure(const SlpFilePtr &slp,
+                              const std::shared_ptr<PalFile> &pal)
+{
+    if (slp)
+        return slp->getMemoryUsage();
+
+    return sizeof(PalFile) + pal->size() * sizeof(Color);
+}
+
+//------------------------------------------------------------------------------
+void ResourceCache::evict(bool all)
+{
+    auto use = lru_.end();
+
+    while (use != lru_.begin() && (all || stats_.bytes > budget_)) {
+        --use;
+
+        auto it = entries_.find(*use);
+        Entry &entry = it->second;
+
+        // Pinned as long as somebody else holds it.
+        if (entry.slp ? entry.slp.use_count() > 1 : entry.pal.use_count() > 1)
+            continue;
+
+        stats_.bytes -= entry.bytes;
+        stats_.entries--;
+        stats_.evictions++;
+
+        use = lru_.erase(use);
+        entries_.erase(it);
+    }
+}
+}
@@ -57,17 +57,16 @@ void SlpFile::loadFile()
 {
     serializeHeader();
 
+    // Frame headers behind the end would be read from whatever follows the
+    // file.
+    if (32 + 32 * uint64_t(num_frames_) > size_)
+        throw std::ios_base::failure("SLP frame headers exceed the file");
+
     frames_.resize(num_frames_);
 
-    if (m_graphicsFileData.empty()) {
-        m_graphicsFileData.resize(size_, 0);
-        std::streampos orig = getIStream()->tellg();
-        getIStream()->seekg(getInitialReadPosition());
-        char *data = reinterpret_cast<char*>(m_graphicsFileData.data());
-        getIStream()->read(data, size_);
-        getIStream()->seekg(orig);
-    } else {
-        std::cerr << "already loaded data" << std::endl;
+    // Reloading reads from the data kept on the first load.
+    if (!m_fileData) {
+        loadFileData();
     }
 
     // Load frame headers
@@ -76,18 +75,69 @@ void SlpFile::loadFile()
         frames_[i]->setSlpFilePos(std::streampos(0));
         frames_[i]->setLoadParams(*getIStream());
         frames_[i]->serializeHeader();
+        frames_[i]->resetLoadParams();
     }
 
-    const char *data = reinterpret_cast<const char*>(m_graphicsFileData.data());
-    std::istringstream istr(std::string(data, m_graphicsFileData.size()));
+    MemoryIStream istr(reinterpret_cast<const char *>(m_fileData), m_fileDataSize);
     // Load frame header
     for (uint32_t i = 0; i < num_frames_; ++i) {
         frames_[i]->load(istr);
+        frames_[i]->resetLoadParams();
     }
 
+    // The stream may be a temporary one, everything read later on comes from
+    // the file data.
+    resetIStream();
+
     loaded_ = true;
 }
 
+//------------------------------------------------------------------------------
+void SlpFile::reload()
+{
+    if (!m_fileData)
+        throw std::logic_error("SLP file was never loaded");
+
+#ifndef NDEBUG
+    log.debug("Reloading SLP from its file data");
+#endif
+
+    MemoryIStream istr(reinterpret_cast<const char *>(m_fileData), m_fileDataSize);
+    setOperation(OP_READ);
+    setIStream(istr);
+
+    try {
+        loadFile();
+    } catch (...) {
+        resetIStream();
+        throw;
+    }
+}
+
+//------------------------------------------------------------------------------
+void SlpFile::loadFileData()
+{
+    MemoryReadBuffer *buffer = getIBuffer();
+    size_t pos = getInitialReadPosition();
+
+    if (buffer && buffer->owner() && pos + size_ <= buffer->size()) {
+        m_fileData = reinterpret_cast<const uint8_t *>(buffer->data()) + pos;
+        m_fileDataSize = size_;
+        m_fileDataOwner = buffer->owner();
+        return;
+    }
+
+    m_graphicsFileData.resize(size_, 0);
+    std::streampos orig = getIStream()->tellg();
+    getIStream()->seekg(getInitialReadPosition());
+    char *data = reinterpret_cast<char*>(m_graphicsFileData.data());
+    getIStream()->read(data, size_);
+    getIStream()->seekg(orig);
+
+    m_fileData = m_graphicsFileData.data();
+    m_fileDataSize = m_graphicsFileData.size();
+}
+
 //------------------------------------------------------------------------------
 void SlpFile::saveFile()
 {
@@ -131,6 +181,21 @@ bool SlpFile::isLoaded(void) const
     return loaded_;
 }
 
+//------------------------------------------------------------------------------
+size_t SlpFile::getMemoryUsage(void)
+{
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+
+    size_t bytes = sizeof(SlpFile) + m_graphicsFileData.capacity();
+
+    for (const SlpFramePtr &frame : frames_) {
+        if (frame)
+            bytes += frame->getMemoryUsage();
+    }
+
+    return bytes;
+}
+
 //------------------------------------------------------------------------------
 uint32_t SlpFile::getFrameCount(void)
 {
@@ -152,19 +217,22 @@ const SlpFramePtr &SlpFile::getFrame(uint32_t frame)
 #ifndef NDEBUG
             log.debug("Reloading SLP, seeking frame [%u]", frame);
 #endif
-            readObject(*getIStream());
+            reload();
             return getFrame(frame);
         }
         log.error("Trying to get frame [%u] from index out of range!", frame);
         throw std::out_of_range("getFrame()");
     }
 
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+
+    // Frames only use the stream while reading their image. The stream of
+    // the file may be gone already when it was read from a temporary one.
     if (frames_[frame]->img_data.pixel_indexes.empty()) {
-        const char *data = reinterpret_cast<const char*>(m_graphicsFileData.data());
-        std::istringstream istr(std::string(data, m_graphicsFileData.size()));
+        MemoryIStream istr(reinterpret_cast<const char *>(m_fileData), m_fileDataSize);
         frames_[frame]->setLoadParams(istr);
         frames_[frame]->readImage();
-        frames_[frame]->setLoadParams(*getIStream());
+        frames_[frame]->resetLoadParams();
     }
 
     return frames_[frame];
@@ -181,7 +249,7 @@ void SlpFile::setFrame(uint32_t frame, SlpFramePtr data)
 int SlpFile::frameCommandsOffset(const size_t frame, const int row)
 {
     if (!loaded_) {
-        readObject(*getIStream());
+        reload();
     }
     if (frame >= frames_.size()) {
         log.error("Trying to get frame [%u] from index out of range!", frame);
@@ -194,7 +262,7 @@ int SlpFile::frameCommandsOffset(const size_t frame, const int row)
 int SlpFile::frameHeight(const size_t frame)
 {
     if (!loaded_) {
-        readObject(*getIStream());
+        reload();
     }
     if (frame >= frames_.size()) {
         log.error("Trying to get frame [%u] from index out of range!", frame);
@@ -207,7 +275,7 @@ int SlpFile::frameHeight(const size_t frame)
 int SlpFile::frameWidth(const size_t frame)
 {
     if (!loaded_) {
-        readObject(*getIStream());
+        reload();
     }
     if (frame >= frames_.size()) {
         log.error("Trying to get frame [%u] from index out of range!", frame);
@@ -33,6 +33,16 @@ namespace genie {
 Logger &SlpFrame::log = Logger::getLogger("genie.SlpFrame");
 const char *CNT_SETS[] = { "CNT_LEFT", "CNT_SAME", "CNT_DIFF", "CNT_TRANSPARENT", "CNT_FEATHERING", "CNT_PLAYER", "CNT_SHIELD", "CNT_PC_OUTLINE", "CNT_SHADOW" };
 
+namespace {
+
+//------------------------------------------------------------------------------
+template <typename T>
+size_t vectorBytes(const std::vector<T> &vec)
+{
+    return vec.capacity() * sizeof(T);
+}
+}
+
 //------------------------------------------------------------------------------
 SlpFrame::SlpFrame()
 {
@@ -59,6 +69,32 @@ uint32_t SlpFrame::getHeight(void) const
     return height_;
 }
 
+//------------------------------------------------------------------------------
+size_t SlpFrame::getMemoryUsage(void) const
+{
+    size_t bytes = sizeof(SlpFrame);
+
+    bytes += vectorBytes(img_data.pixel_indexes);
+    bytes += vectorBytes(img_data.bgra_channels);
+    bytes += vectorBytes(img_data.alpha_channel);
+    bytes += vectorBytes(img_data.shadow_mask);
+    bytes += vectorBytes(img_data.shield_mask);
+    bytes += vectorBytes(img_data.outline_pc_mask);
+    bytes += vectorBytes(img_data.transparency_mask);
+    bytes += vectorBytes(img_data.player_color_mask);
+    bytes += vectorBytes(img_data.palette);
+
+    bytes += vectorBytes(left_edges_);
+    bytes += vectorBytes(right_edges_);
+    bytes += vectorBytes(cmd_offsets_);
+    bytes += vectorBytes(commands_);
+
+    for (const std::vector<uint8_t> &command : commands_)
+        bytes += vectorBytes(command);
+
+    return bytes;
+}
+
 void SlpFrame::setSize(const uint32_t width, const uint32_t height)
 {
 
@@ -176,6 +212,11 @@ void SlpFrame::setLoadParams(std::istream &istr)
     setOperation(OP_READ);
 }
 
+void SlpFrame::resetLoadParams(void)
+{
+    resetIStream();
+}
+
 void SlpFrame::setSaveParams(std::ostream &ostr, uint32_t &slp_offset_)
 {
     setOStream(ostr);
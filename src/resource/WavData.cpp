@@ -0,0 +1,79 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "genie/resource/WavData.h"
+
+#include <string.h>
+
+namespace genie {
+
+namespace {
+
+//------------------------------------------------------------------------------
+template <typename T>
+T get(const uint8_t *src)
+{
+    T value;
+    memcpy(&value, src, sizeof(T));
+    return value;
+}
+}
+
+//------------------------------------------------------------------------------
+bool WavData::parse(void)
+{
+    const uint8_t *file = data.get();
+
+    if (!file || size < 12 || memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0)
+        return false;
+
+    bool has_format = false;
+    size_t pos = 12;
+
+    while (size - pos >= 8) {
+        const uint8_t *chunk = file + pos;
+        size_t len = get<uint32_t>(chunk + 4);
+
+        pos += 8;
+
+        // Some files claim more than they hold.
+        if (len > size - pos)
+            len = size - pos;
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && len >= 16) {
+            format = get<uint16_t>(chunk + 8);
+            channels = get<uint16_t>(chunk + 10);
+            sample_rate = get<uint32_t>(chunk + 12);
+            bits_per_sample = get<uint16_t>(chunk + 22);
+            has_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            samples = chunk + 8;
+            samples_size = len;
+        }
+
+        // Chunks are padded to an even size.
+        pos += len + (len & 1);
+
+        if (pos > size)
+            break;
+    }
+
+    return has_format && samples;
+}
+}
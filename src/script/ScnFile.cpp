@@ -27,11 +27,6 @@
 
 namespace genie {
 
-std::string ISerializable::scn_ver = "0.00";
-float ISerializable::scn_plr_data_ver = 0.f;
-float ISerializable::scn_internal_ver = 0.f;
-double ISerializable::scn_trigger_ver = 0.0;
-
 Logger &ScnFile::log = Logger::getLogger("genie.ScnFile");
 
 
@@ -39,7 +34,6 @@ Logger &ScnFile::log = Logger::getLogger("genie.ScnFile");
 ScnFile::ScnFile() :
     IFile(), compressor_(this)
 {
-    scn_internal_ver = 0.f;
 }
 
 //------------------------------------------------------------------------------
@@ -47,7 +41,7 @@ ScnFile::~ScnFile()
 {
 }
 
-void ScnFile::extractRaw(const char *from, const char *to)
+size_t ScnFile::extractRaw(const char *from, const char *to)
 {
     std::ifstream ifs;
     std::ofstream ofs;
@@ -69,10 +63,12 @@ void ScnFile::extractRaw(const char *from, const char *to)
     ifs.read(header.data(), headerLen);
     ofs.write(header.data(), headerLen);
 
-    Compressor::decompress(ifs, ofs);
+    size_t size = Compressor::decompress(ifs, ofs);
 
     ifs.close();
     ofs.close();
+
+    return 8 + headerLen + size;
 }
 
 //------------------------------------------------------------------------------
@@ -81,6 +77,24 @@ uint32_t ScnFile::getSeparator(void)
     return 0xFFFFFF9D;
 }
 
+//------------------------------------------------------------------------------
+void ScnFile::setDecompressionMode(Compressor::DecompressionMode mode)
+{
+    compressor_.setDecompressionMode(mode);
+}
+
+//------------------------------------------------------------------------------
+bool ScnFile::setCompressionBackend(CompressionBackend::Type type)
+{
+    return compressor_.setCompressionBackend(type);
+}
+
+//------------------------------------------------------------------------------
+void ScnFile::setCompressionProfile(Compressor::CompressionProfile profile)
+{
+    compressor_.setCompressionProfile(profile);
+}
+
 bool ScnFile::verifyVersion()
 {
     if (version.size() < 4) {
@@ -125,7 +139,7 @@ void ScnFile::serializeObject(void)
         return;
     }
 
-    if (isOperation(OP_WRITE)) {
+    if (!isOperation(OP_READ)) {
         headerLength_ = 21 + scenarioInstructions.size();
     }
 
@@ -156,19 +170,19 @@ void ScnFile::serializeObject(void)
 
     serialize<ISerializable>(map);
 
-    if (scn_ver == "1.20" || scn_ver == "1.21")
-        scn_internal_ver = 1.14f;
-    else if (scn_ver == "1.17" || scn_ver == "1.18" || scn_ver == "1.19")
-        scn_internal_ver = 1.13f;
-    else if (scn_ver == "1.14" || scn_ver == "1.15" || scn_ver == "1.16")
-        scn_internal_ver = 1.12f;
-    else if (scn_ver == "1.22")
-        scn_internal_ver = 1.15f;
+    if (context().scn_ver == "1.20" || context().scn_ver == "1.21")
+        context().scn_internal_ver = 1.14f;
+    else if (context().scn_ver == "1.17" || context().scn_ver == "1.18" || context().scn_ver == "1.19")
+        context().scn_internal_ver = 1.13f;
+    else if (context().scn_ver == "1.14" || context().scn_ver == "1.15" || context().scn_ver == "1.16")
+        context().scn_internal_ver = 1.12f;
+    else if (context().scn_ver == "1.22")
+        context().scn_internal_ver = 1.15f;
     else
-        std::cerr << "unhandled version " << scn_ver << std::endl;
+        std::cerr << "unhandled version " << context().scn_ver << std::endl;
 
     serializeSize<uint32_t>(playerUnitsCount, playerUnits.size());
-    if (scn_internal_ver > 1.06f)
+    if (context().scn_internal_ver > 1.06f)
         serializeSub<ScnPlayerResources>(playerResources, 8);
     else {
         // A lot of data is read here.
@@ -180,18 +194,18 @@ void ScnFile::serializeObject(void)
     serialize<uint32_t>(playerCount2_);
     serializeSub<ScnMorePlayerData>(players, 8);
 
-    triggerVersion = scn_trigger_ver;
+    triggerVersion = context().scn_trigger_ver;
     serialize<double>(triggerVersion);
-    scn_trigger_ver = triggerVersion;
+    context().scn_trigger_ver = triggerVersion;
 
-    if (scn_trigger_ver > 1.4f)
+    if (context().scn_trigger_ver > 1.4f)
         serialize<int8_t>(objectivesStartingState);
     serializeSize<uint32_t>(numTriggers_, triggers.size());
     serializeSub<Trigger>(triggers, numTriggers_);
-    if (scn_trigger_ver > 1.3f)
+    if (context().scn_trigger_ver > 1.3f)
         serialize<int32_t>(triggerDisplayOrder, numTriggers_);
 
-    if (scn_ver == "1.22" || scn_ver == "1.21" || scn_ver == "1.20" || scn_ver == "1.19" || scn_ver == "1.18") {
+    if (context().scn_ver == "1.22" || context().scn_ver == "1.21" || context().scn_ver == "1.20" || context().scn_ver == "1.19" || context().scn_ver == "1.18") {
         serialize<uint32_t>(includeFiles);
         serialize<uint32_t>(perErrorIncluded);
         if (perErrorIncluded)
@@ -292,9 +306,9 @@ void ScnFile::serializeVersion(void)
     }
   }*/
 
-    version = scn_ver;
+    version = context().scn_ver;
     serialize(version, 4);
-    scn_ver = version;
+    context().scn_ver = version;
 }
 
 //------------------------------------------------------------------------------
@@ -327,9 +341,9 @@ void ScnMainPlayerData::serializePlayerDataVersion(void)
     }
   }*/
 
-    playerDataVersion = scn_plr_data_ver;
+    playerDataVersion = context().scn_plr_data_ver;
     serialize<float>(playerDataVersion);
-    scn_plr_data_ver = playerDataVersion;
+    context().scn_plr_data_ver = playerDataVersion;
 
     /*if (isOperation(OP_READ))
   {
@@ -414,6 +428,12 @@ BlnFile::BlnFile() :
 {
 }
 
+//------------------------------------------------------------------------------
+void BlnFile::setCompressionProfile(Compressor::CompressionProfile profile)
+{
+    compressor_.setCompressionProfile(profile);
+}
+
 void BlnFile::serializeObject()
 {
     compressor_.beginCompression();
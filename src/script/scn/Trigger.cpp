@@ -39,17 +39,17 @@ void Trigger::serializeObject(void)
     serialize<int32_t>(stringTableID);
     serialize<int8_t>(isObjective);
     serialize<int32_t>(descriptionOrder);
-    if (scn_trigger_ver > 1.5f)
+    if (context().scn_trigger_ver > 1.5f)
         serialize<int32_t>(startingTime);
     serializeForcedString<int32_t>(description);
     serializeForcedString<int32_t>(name);
     serializeSize<int32_t>(numEffects_, effects.size());
     serializeSub<TriggerEffect>(effects, numEffects_);
-    if (scn_trigger_ver > 1.2f)
+    if (context().scn_trigger_ver > 1.2f)
         serialize<int32_t>(effectDisplayOrder, numEffects_);
     serializeSize<int32_t>(numConditions_, conditions.size());
     serializeSub<TriggerCondition>(conditions, numConditions_);
-    if (scn_trigger_ver > 1.2f)
+    if (context().scn_trigger_ver > 1.2f)
         serialize<int32_t>(conditionDisplayOrder, numConditions_);
 }
 
@@ -64,8 +64,8 @@ TriggerCondition::~TriggerCondition()
 void TriggerCondition::serializeObject(void)
 {
     serialize<int32_t>(type);
-    if (scn_trigger_ver > 1.0f) {
-        if (isOperation(OP_WRITE)) // Automatic compression.
+    if (context().scn_trigger_ver > 1.0f) {
+        if (!isOperation(OP_READ)) // Automatic compression.
         {
             usedVariables = 16;
             int32_t *browser = &aiSignal;
@@ -95,8 +95,8 @@ TriggerEffect::~TriggerEffect()
 void TriggerEffect::serializeObject(void)
 {
     serialize<int32_t>(type);
-    if (scn_trigger_ver > 1.0f) {
-        if (isOperation(OP_WRITE)) // Automatic compression.
+    if (context().scn_trigger_ver > 1.0f) {
+        if (!isOperation(OP_READ)) // Automatic compression.
         {
             usedVariables = 23;
             int32_t *browser = &instructionPanel;
@@ -115,7 +115,7 @@ void TriggerEffect::serializeObject(void)
     serialize<int32_t>(&start, usedVariables);
     serializeForcedString<int32_t>(message);
     serializeForcedString<int32_t>(soundFile);
-    if (scn_trigger_ver > 1.1f && usedVariables >= 5 && setObjects > 0)
+    if (context().scn_trigger_ver > 1.1f && usedVariables >= 5 && setObjects > 0)
         serialize<int32_t>(selectedUnits, setObjects);
 }
 }
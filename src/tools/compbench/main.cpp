@@ -0,0 +1,150 @@
+/*
+    genieutils - A library for reading and writing data files of genie
+               engine games.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zstr.hpp>
+
+#include "genie/file/CompressionBackend.h"
+
+using genie::CompressionBackend;
+
+namespace {
+
+const int RUNS = 5;
+
+//------------------------------------------------------------------------------
+/// Best time of RUNS calls of f in milliseconds.
+//
+template <typename F>
+double bestOf(F f)
+{
+    double best = 0;
+
+    for (int i = 0; i < RUNS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        if (i == 0 || ms < best)
+            best = ms;
+    }
+
+    return best;
+}
+
+//------------------------------------------------------------------------------
+/// Offset of the compressed data. Scenarios start with an uncompressed
+/// header, dat files are compressed completely.
+//
+size_t payloadOffset(const std::string &fileName, const std::vector<char> &data)
+{
+    std::string ext = fileName.substr(fileName.find_last_of('.') + 1);
+
+    if ((ext == "scn" || ext == "scx") && data.size() >= 8) {
+        uint32_t headerLength;
+        memcpy(&headerLength, data.data() + 4, sizeof(headerLength));
+        return 8 + headerLength;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void printRow(const char *name, const char *what, size_t bytes, double ms)
+{
+    printf("  %-12s %-8s %9.2f ms %9.1f MB/s\n", name, what, ms,
+           bytes / 1e6 / (ms / 1000));
+}
+}
+
+/// Usage: compbench [-l level] file.dat|file.scx ...
+///
+/// Compares the compression backends on the compressed part of the files.
+int main(int argc, char **argv)
+{
+    int level = 6;
+    int first = 1;
+
+    if (argc > 2 && std::string(argv[1]) == "-l") {
+        level = atoi(argv[2]);
+        first = 3;
+    }
+
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [-l level] file.dat|file.scx ...\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = first; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+
+        size_t offset = payloadOffset(argv[i], data);
+        const char *src = data.data() + offset;
+        size_t size = data.size() - offset;
+
+        std::vector<char> raw;
+        const CompressionBackend *reference = CompressionBackend::getDefault();
+
+        if (!reference || !reference->inflateRaw(src, size, raw)) {
+            fprintf(stderr, "%s: can't decompress\n", argv[i]);
+            continue;
+        }
+
+        printf("%s: %zu bytes compressed, %zu uncompressed\n", argv[i], size,
+               raw.size());
+
+        // What Compressor does with DECOMPRESS_STREAMING
+        double ms = bestOf([&] {
+            std::istringstream in(std::string(src, size));
+            zstr::istream inflated(in, (std::size_t)1 << 20, false, -15);
+            std::vector<char> block((std::size_t)1 << 20);
+
+            while (inflated.read(block.data(), block.size()) || inflated.gcount() > 0) {
+            }
+        });
+        printRow("zstr", "inflate", raw.size(), ms);
+
+        for (CompressionBackend::Type type : CompressionBackend::available()) {
+            const CompressionBackend *backend = CompressionBackend::get(type);
+            std::vector<char> out;
+
+            ms = bestOf([&] { backend->inflateRaw(src, size, out); });
+            printRow(backend->name(), "inflate", raw.size(), ms);
+
+            if (out != raw)
+                printf("  %s: inflated data differs!\n", backend->name());
+
+            ms = bestOf([&] { backend->deflateRaw(raw.data(), raw.size(), level, out); });
+            printRow(backend->name(), "deflate", raw.size(), ms);
+            printf("  %-12s level %d: %zu bytes\n", backend->name(), level, out.size());
+        }
+    }
+
+    return 0;
+}
@@ -17,6 +17,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
 #include <iostream>
 #include "genie/dat/DatFile.h"
 #include <boost/program_options.hpp>
@@ -61,8 +62,15 @@ int main(int argc, char **argv)
             file.setVerboseMode(true);
 
         if (vm.count("raw-out")) {
-            file.extractRaw(vm["input-file"].as<std::string>().c_str(),
-                            vm["output-file"].as<std::string>().c_str());
+            auto start = std::chrono::steady_clock::now();
+
+            size_t size = file.extractRaw(vm["input-file"].as<std::string>().c_str(),
+                                          vm["output-file"].as<std::string>().c_str());
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << "Extracted " << size << " bytes in " << seconds * 1000
+                      << " ms (" << size / 1e6 / seconds << " MB/s)" << std::endl;
         } else if (vm.count("geniedat")) {
             if (vm["game"].as<std::string>() == "aoe")
                 file.setGameVersion(genie::GV_AoE);
@@ -0,0 +1,275 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define BOOST_TEST_MODULE dat_load_test
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "genie/dat/DatFile.h"
+
+#include "DatTestData.h"
+
+const char *const DAT_PATH = "dat_load_test.dat";
+const char *const SAVED_PATH = "dat_load_test_saved.dat";
+const char *const SNAPSHOT_PATH = "dat_load_test.snap";
+
+// Saves a filled file and returns its content.
+std::string saveFilledFile(void)
+{
+    genie::DatFile file;
+    fillFile(file);
+    file.saveAs(DAT_PATH);
+
+    return readFile(DAT_PATH);
+}
+
+// Content of file saved.
+std::string saved(genie::DatFile &file)
+{
+    file.saveAs(SAVED_PATH);
+
+    return readFile(SAVED_PATH);
+}
+
+// Flips the bits of the byte at pos of the file.
+void corrupt(const char *fileName, std::streamoff pos)
+{
+    std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+    char byte;
+
+    file.seekg(pos);
+    file.get(byte);
+    file.seekp(pos);
+    file.put(char(~byte));
+}
+
+// Loads the saved file with the snapshot.
+void loadWithSnapshot(genie::DatFile &file)
+{
+    file.setGameVersion(genie::GV_TC);
+    file.setSnapshotFile(SNAPSHOT_PATH);
+    file.load(DAT_PATH);
+}
+
+// Content of the saved file after it was loaded as usual and changed by
+// change.
+template <typename Change>
+std::string savedEager(Change change)
+{
+    genie::DatFile file;
+    file.setGameVersion(genie::GV_TC);
+    file.load(DAT_PATH);
+    change(file);
+
+    return saved(file);
+}
+
+BOOST_AUTO_TEST_CASE(lazy_load_test)
+{
+    std::string data = saveFilledFile();
+
+    genie::DatFile file;
+    file.setGameVersion(genie::GV_TC);
+    file.setLazyLoading(true);
+    file.load(DAT_PATH);
+
+    BOOST_CHECK(!file.isSectionLoaded(genie::DatFile::SECTION_TECHS));
+    BOOST_CHECK(saved(file) == data);
+
+    file.loadSection(genie::DatFile::SECTION_TECHS);
+    BOOST_REQUIRE_EQUAL(file.Techs.size(), TECH_COUNT);
+    file.Techs[3].ResearchTime = 30;
+
+    BOOST_CHECK(!file.isSectionLoaded(genie::DatFile::SECTION_CIVS));
+    BOOST_CHECK(saved(file) == savedEager([](genie::DatFile &loaded) {
+                    loaded.Techs[3].ResearchTime = 30;
+                }));
+}
+
+BOOST_AUTO_TEST_CASE(lazy_version_change_test)
+{
+    saveFilledFile();
+
+    // Sections not loaded yet are written in the layout of the new version.
+    genie::DatFile file;
+    file.setGameVersion(genie::GV_TC);
+    file.setLazyLoading(true);
+    file.load(DAT_PATH);
+    file.loadSection(genie::DatFile::SECTION_TECHS);
+    file.setGameVersion(genie::GV_AoK);
+
+    BOOST_CHECK(file.isSectionLoaded(genie::DatFile::SECTION_CIVS));
+    BOOST_CHECK(saved(file) == savedEager([](genie::DatFile &loaded) {
+                    loaded.setGameVersion(genie::GV_AoK);
+                }));
+}
+
+BOOST_AUTO_TEST_CASE(incremental_save_test)
+{
+    std::string data = saveFilledFile();
+
+    genie::DatFile file;
+    file.setGameVersion(genie::GV_TC);
+    file.setIncrementalSaving(true);
+    file.load(DAT_PATH);
+
+    // Sections hashed while loading don't refer to the hashing codec.
+    file.TerrainBlock.setGameVersion(genie::GV_TC);
+
+    BOOST_CHECK(saved(file) == data);
+
+    file.Techs[3].ResearchTime = 30;
+    BOOST_CHECK(saved(file) == savedEager([](genie::DatFile &loaded) {
+                    loaded.Techs[3].ResearchTime = 30;
+                }));
+
+    // The next save keeps what the last one wrote.
+    file.Civs[1].Name = "Other";
+    BOOST_CHECK(saved(file) == savedEager([](genie::DatFile &loaded) {
+                    loaded.Techs[3].ResearchTime = 30;
+                    loaded.Civs[1].Name = "Other";
+                }));
+
+    file.setGameVersion(genie::GV_AoK);
+    BOOST_CHECK(saved(file) == savedEager([](genie::DatFile &loaded) {
+                    loaded.Techs[3].ResearchTime = 30;
+                    loaded.Civs[1].Name = "Other";
+                    loaded.setGameVersion(genie::GV_AoK);
+                }));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_test)
+{
+    std::string data = saveFilledFile();
+    std::remove(SNAPSHOT_PATH);
+
+    genie::DatFile first;
+    loadWithSnapshot(first);
+
+    BOOST_CHECK(!first.isLoadedFromSnapshot());
+    BOOST_CHECK(saved(first) == data);
+
+    genie::DatFile second;
+    loadWithSnapshot(second);
+
+    BOOST_CHECK(second.isLoadedFromSnapshot());
+    BOOST_CHECK_EQUAL(second.Techs.size(), TECH_COUNT);
+    BOOST_CHECK(saved(second) == data);
+
+    genie::DatFile lazy;
+    lazy.setLazyLoading(true);
+    loadWithSnapshot(lazy);
+    lazy.loadSection(genie::DatFile::SECTION_TECHS);
+    lazy.Techs[3].ResearchTime = 30;
+
+    BOOST_CHECK(lazy.isLoadedFromSnapshot());
+    BOOST_CHECK(saved(lazy) == savedEager([](genie::DatFile &loaded) {
+                    loaded.Techs[3].ResearchTime = 30;
+                }));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_rejection_test)
+{
+    std::string data = saveFilledFile();
+    std::remove(SNAPSHOT_PATH);
+
+    {
+        genie::DatFile file;
+        loadWithSnapshot(file);
+    }
+
+    // Unknown header, the file is loaded as usual and the snapshot
+    // written again.
+    corrupt(SNAPSHOT_PATH, 0);
+
+    genie::DatFile badHeader;
+    loadWithSnapshot(badHeader);
+
+    BOOST_CHECK(!badHeader.isLoadedFromSnapshot());
+    BOOST_CHECK(saved(badHeader) == data);
+
+    genie::DatFile rewritten;
+    loadWithSnapshot(rewritten);
+
+    BOOST_CHECK(rewritten.isLoadedFromSnapshot());
+
+    // Changed data.
+    size_t size = readFile(SNAPSHOT_PATH).size();
+    corrupt(SNAPSHOT_PATH, size / 2);
+
+    genie::DatFile badBody;
+    loadWithSnapshot(badBody);
+
+    BOOST_CHECK(!badBody.isLoadedFromSnapshot());
+    BOOST_CHECK(saved(badBody) == data);
+
+    // Snapshot of another dat file.
+    genie::DatFile changed;
+    fillFile(changed);
+    changed.Techs[3].ResearchTime = 30;
+    changed.saveAs(DAT_PATH);
+
+    genie::DatFile other;
+    loadWithSnapshot(other);
+
+    BOOST_CHECK(!other.isLoadedFromSnapshot());
+    BOOST_CHECK_EQUAL(other.Techs[3].ResearchTime, 30);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_load_test)
+{
+    std::string data = saveFilledFile();
+    std::remove(SNAPSHOT_PATH);
+
+    {
+        genie::DatFile file;
+        loadWithSnapshot(file);
+    }
+
+    // The snapshot knows where all sections and civs start, so they are
+    // read by several threads.
+    for (unsigned threads : { 1u, 2u, 4u }) {
+        genie::DatFile file;
+        file.setLoadThreads(threads);
+        loadWithSnapshot(file);
+
+        BOOST_CHECK(file.isLoadedFromSnapshot());
+        BOOST_CHECK_EQUAL(file.Civs.size(), CIV_COUNT);
+        BOOST_CHECK(saved(file) == data);
+    }
+
+    genie::DatFile lazy;
+    lazy.setLazyLoading(true);
+    lazy.setLoadThreads(4);
+    loadWithSnapshot(lazy);
+    lazy.loadSection(genie::DatFile::SECTION_TECHS);
+    lazy.Techs[3].ResearchTime = 30;
+    lazy.loadAllSections();
+
+    // The sections taken from the readers don't refer to them anymore.
+    lazy.TerrainBlock.setGameVersion(genie::GV_TC);
+    lazy.setGameVersion(genie::GV_AoK);
+
+    BOOST_CHECK(saved(lazy) == savedEager([](genie::DatFile &loaded) {
+                    loaded.Techs[3].ResearchTime = 30;
+                    loaded.setGameVersion(genie::GV_AoK);
+                }));
+}
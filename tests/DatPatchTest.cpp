@@ -0,0 +1,183 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define BOOST_TEST_MODULE dat_patch_test
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "genie/dat/DatFile.h"
+#include "genie/dat/DatFingerprint.h"
+#include "genie/dat/DatPatch.h"
+
+#include "DatTestData.h"
+
+const char *const DAT_PATH = "dat_patch_test.dat";
+
+uint64_t fileHash(genie::DatFile &file)
+{
+    genie::DatFingerprint print;
+    print.build(file);
+
+    return print.getFileHash();
+}
+
+BOOST_AUTO_TEST_CASE(diff_apply_test)
+{
+    genie::DatFile base, changed, target;
+    fillFile(base);
+    fillFile(changed);
+    fillFile(target);
+
+    changed.Techs[2].ResearchTime = 100;
+    changed.Civs[1].Name = "Other";
+    changed.Techs.pop_back();
+
+    genie::DatPatch patch;
+    patch.diff(base, changed);
+
+    BOOST_CHECK(!patch.Entries.empty());
+    BOOST_CHECK(fileHash(target) != fileHash(changed));
+
+    patch.apply(target);
+
+    BOOST_CHECK_EQUAL(target.Techs.size(), TECH_COUNT - 1);
+    BOOST_CHECK_EQUAL(target.Techs[2].ResearchTime, 100);
+    BOOST_CHECK_EQUAL(target.Civs[1].Name, "Other");
+    BOOST_CHECK_EQUAL(fileHash(target), fileHash(changed));
+
+    // Equal files give an empty patch.
+    patch.diff(changed, target);
+    BOOST_CHECK(patch.Entries.empty());
+}
+
+BOOST_AUTO_TEST_CASE(apply_save_test)
+{
+    genie::DatFile base, changed;
+    fillFile(base);
+    fillFile(changed);
+
+    changed.Techs[5].ResearchTime = 200;
+    changed.TerrainRestrictions.resize(2);
+    changed.FloatPtrTerrainTables.assign(2, 1);
+    changed.TerrainPassGraphicPointers.assign(2, 1);
+
+    genie::DatPatch patch;
+    patch.diff(base, changed);
+    patch.apply(base);
+
+    // The patched objects don't refer to the codec of apply() anymore.
+    base.setGameVersion(genie::GV_TC);
+    base.TerrainBlock.setGameVersion(genie::GV_TC);
+    base.saveAs(DAT_PATH);
+
+    genie::DatFile loaded;
+    loaded.setGameVersion(genie::GV_TC);
+    loaded.load(DAT_PATH);
+
+    BOOST_CHECK_EQUAL(loaded.Techs[5].ResearchTime, 200);
+    BOOST_CHECK_EQUAL(loaded.TerrainRestrictions.size(), 2u);
+    BOOST_CHECK_EQUAL(fileHash(loaded), fileHash(changed));
+}
+
+BOOST_AUTO_TEST_CASE(merge_test)
+{
+    genie::DatFile base, ours, theirs, expected;
+    fillFile(base);
+    fillFile(ours);
+    fillFile(theirs);
+    fillFile(expected);
+
+    ours.Techs[1].ResearchTime = 50;
+    theirs.Techs[3].ResearchTime = 60;
+    expected.Techs[1].ResearchTime = 50;
+    expected.Techs[3].ResearchTime = 60;
+
+    // Same change on both sides.
+    ours.Civs[2].Name = "Both";
+    theirs.Civs[2].Name = "Both";
+    expected.Civs[2].Name = "Both";
+
+    genie::DatPatch ourPatch, theirPatch, merged;
+    ourPatch.diff(base, ours);
+    theirPatch.diff(base, theirs);
+
+    std::vector<genie::DatPatch::Conflict> conflicts;
+    merged.merge(ourPatch, theirPatch, conflicts);
+
+    BOOST_CHECK(conflicts.empty());
+
+    merged.apply(base);
+    BOOST_CHECK_EQUAL(fileHash(base), fileHash(expected));
+}
+
+BOOST_AUTO_TEST_CASE(merge_conflict_test)
+{
+    genie::DatFile base, ours, theirs;
+    fillFile(base);
+    fillFile(ours);
+    fillFile(theirs);
+
+    ours.Techs[4].ResearchTime = 5;
+    theirs.Techs[4].ResearchTime = 6;
+
+    genie::DatPatch ourPatch, theirPatch, merged;
+    ourPatch.diff(base, ours);
+    theirPatch.diff(base, theirs);
+
+    std::vector<genie::DatPatch::Conflict> conflicts;
+    merged.merge(ourPatch, theirPatch, conflicts);
+
+    BOOST_REQUIRE_EQUAL(conflicts.size(), 1u);
+    BOOST_CHECK_EQUAL(conflicts[0].Ours.Item, genie::DatPatch::TECHS);
+    BOOST_CHECK_EQUAL(conflicts[0].Ours.Index, 4u);
+    BOOST_CHECK_EQUAL(conflicts[0].Theirs.Index, 4u);
+
+    // The change of ours is kept.
+    merged.apply(base);
+    BOOST_CHECK_EQUAL(base.Techs[4].ResearchTime, 5);
+}
+
+BOOST_AUTO_TEST_CASE(merge_resize_conflict_test)
+{
+    genie::DatFile base, ours, theirs;
+    fillFile(base);
+    fillFile(ours);
+    fillFile(theirs);
+
+    ours.Techs.resize(4);
+    theirs.Techs[6].ResearchTime = 70;
+    theirs.Techs[1].ResearchTime = 10;
+
+    genie::DatPatch ourPatch, theirPatch, merged;
+    ourPatch.diff(base, ours);
+    theirPatch.diff(base, theirs);
+
+    std::vector<genie::DatPatch::Conflict> conflicts;
+    merged.merge(ourPatch, theirPatch, conflicts);
+
+    // The edit behind the new end is dropped, the other one is kept.
+    BOOST_REQUIRE_EQUAL(conflicts.size(), 1u);
+    BOOST_CHECK(conflicts[0].Ours.Resize);
+    BOOST_CHECK_EQUAL(conflicts[0].Ours.Index, 4u);
+    BOOST_CHECK_EQUAL(conflicts[0].Theirs.Index, 6u);
+
+    merged.apply(base);
+    BOOST_CHECK_EQUAL(base.Techs.size(), 4u);
+    BOOST_CHECK_EQUAL(base.Techs[1].ResearchTime, 10);
+}
@@ -0,0 +1,88 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENIE_DATTESTDATA_H
+#define GENIE_DATTESTDATA_H
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "genie/dat/DatFile.h"
+
+const size_t TECH_COUNT = 8;
+const size_t CIV_COUNT = 3;
+
+// Fills file with the same small data every time, so files filled this way
+// start out equal.
+inline void fillFile(genie::DatFile &file)
+{
+    // Terrains have members without initializers, all files get a copy of
+    // the same ones.
+    static const genie::TerrainBlock terrains = [] {
+        genie::TerrainBlock block;
+        block.setGameVersion(genie::GV_TC);
+        block.TerrainBorders.resize(16);
+
+        for (genie::TerrainBorder &border : block.TerrainBorders)
+            for (std::vector<genie::FrameData> &frames : border.Borders)
+                frames.resize(12);
+
+        return block;
+    }();
+
+    file.TerrainBlock = terrains;
+    file.setGameVersion(genie::GV_TC);
+
+    file.TimeSlice = 0;
+    file.UnitKillRate = 0;
+    file.UnitKillTotal = 0;
+    file.UnitHitPointRate = 0;
+    file.UnitHitPointTotal = 0;
+    file.RazingKillRate = 0;
+    file.RazingKillTotal = 0;
+    file.TerrainsUsed1 = 0;
+    file.SUnknown2 = file.SUnknown3 = file.SUnknown4 = file.SUnknown5 = 0;
+    file.SUnknown7 = file.SUnknown8 = 0;
+
+    file.Techs.resize(TECH_COUNT);
+
+    for (size_t i = 0; i < file.Techs.size(); ++i) {
+        file.Techs[i].setGameVersion(genie::GV_TC);
+        file.Techs[i].ResearchTime = i;
+    }
+
+    file.Civs.resize(CIV_COUNT);
+
+    for (size_t i = 0; i < file.Civs.size(); ++i) {
+        file.Civs[i].setGameVersion(genie::GV_TC);
+        file.Civs[i].Name = "Civ";
+    }
+}
+
+// Whole content of a file, to compare saved files.
+inline std::string readFile(const char *fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+#endif // GENIE_DATTESTDATA_H
@@ -0,0 +1,290 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define BOOST_TEST_MODULE drs_file_test
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <ios>
+#include <thread>
+#include <vector>
+
+#include "genie/resource/DrsFile.h"
+#include "genie/resource/DrsWriter.h"
+#include "genie/resource/PalFile.h"
+#include "genie/resource/SlpFile.h"
+
+#include "ResourceTestData.h"
+
+const char *const DRS_PATH = "drs_file_test.drs";
+
+const uint32_t SLP_COUNT = 20;
+const uint32_t FIRST_SLP = 100;
+const uint32_t PAL_ID = 50;
+const uint32_t PAL_COLORS = 10;
+const unsigned THREAD_COUNT = 8;
+
+// Slp file id is FIRST_SLP + i with a frame of (i + 1) x (i + 2) pixels.
+void writeDrs(void)
+{
+    genie::DrsWriter writer;
+
+    for (uint32_t i = 0; i < SLP_COUNT; ++i)
+        writer.setResource(genie::DrsWriter::SLP, FIRST_SLP + i, makeSlp(i + 1, i + 2));
+
+    writer.setResource(genie::DrsWriter::BINARY, PAL_ID, makePal(PAL_COLORS));
+    writer.saveAs(DRS_PATH);
+}
+
+// Slp file claiming more frames than it holds.
+std::vector<char> makeBadSlp(void)
+{
+    std::vector<char> data = { '2', '.', '0', 'N' };
+    put32(data, 100000);
+    data.resize(data.size() + 24, 0);
+
+    return data;
+}
+
+// Wav data over a copy of file.
+genie::WavData wavOf(const std::vector<char> &file)
+{
+    std::shared_ptr<uint8_t> data(new uint8_t[file.size()], std::default_delete<uint8_t[]>());
+    std::memcpy(data.get(), file.data(), file.size());
+
+    genie::WavData wav;
+    wav.data = data;
+    wav.size = file.size();
+
+    return wav;
+}
+
+// Wav file with an odd sized chunk between the fmt and data chunks.
+std::vector<char> makeOddWav(uint32_t samples)
+{
+    std::vector<char> file = makeWav(samples);
+    std::vector<char> chunk = { 'L', 'I', 'S', 'T' };
+    put32(chunk, 3);
+    chunk.insert(chunk.end(), { 'a', 'b', 'c', 0 });
+
+    // Behind the RIFF header and the fmt chunk.
+    file.insert(file.begin() + 36, chunk.begin(), chunk.end());
+
+    return file;
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_access_test)
+{
+    writeDrs();
+
+    genie::DrsFile drs;
+    drs.setConcurrentAccess(true);
+    drs.load(DRS_PATH);
+
+    // What every thread got, each file has to be read once.
+    std::vector<std::vector<genie::SlpFilePtr>> slps(THREAD_COUNT);
+    std::vector<std::shared_ptr<genie::PalFile>> pals(THREAD_COUNT);
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < THREAD_COUNT; ++t) {
+        threads.emplace_back([&drs, &slps, &pals, t] {
+            for (uint32_t i = 0; i < SLP_COUNT; ++i) {
+                uint32_t id = FIRST_SLP + (i + t) % SLP_COUNT;
+                genie::SlpFilePtr slp = drs.getSlpFile(id);
+                slp->getFrame(0);
+                slps[t].push_back(slp);
+            }
+
+            pals[t] = drs.getPalFilePtr(PAL_ID);
+        });
+    }
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (unsigned t = 0; t < THREAD_COUNT; ++t) {
+        BOOST_CHECK(pals[t] == pals[0]);
+
+        for (uint32_t i = 0; i < SLP_COUNT; ++i)
+            BOOST_CHECK(slps[t][i] == drs.getSlpFile(FIRST_SLP + (i + t) % SLP_COUNT));
+    }
+
+    genie::SlpFilePtr slp = drs.getSlpFile(FIRST_SLP + 5);
+    BOOST_CHECK_EQUAL(slp->getFrame(0)->getWidth(), 6u);
+    BOOST_CHECK_EQUAL(slp->getFrame(0)->getHeight(), 7u);
+
+    BOOST_REQUIRE(pals[0]);
+    BOOST_REQUIRE_EQUAL(pals[0]->size(), PAL_COLORS);
+    BOOST_CHECK_EQUAL((*pals[0])[3].g, 4);
+}
+
+BOOST_AUTO_TEST_CASE(reload_test)
+{
+    writeDrs();
+
+    // Concurrent files are read through temporary streams, the others
+    // through the stream of the drs file.
+    for (bool concurrent : { false, true }) {
+        genie::DrsFile drs;
+        drs.setConcurrentAccess(concurrent);
+        drs.load(DRS_PATH);
+
+        genie::SlpFilePtr slp = drs.getSlpFile(FIRST_SLP + 3);
+        BOOST_REQUIRE(slp);
+        BOOST_CHECK_EQUAL(slp->getFrame(0)->getWidth(), 4u);
+
+        slp->unload();
+        BOOST_CHECK(!slp->isLoaded());
+
+        // Frames are read again from the data of the slp file.
+        BOOST_CHECK_EQUAL(slp->getFrame(0)->getWidth(), 4u);
+        BOOST_CHECK_EQUAL(slp->getFrame(0)->getHeight(), 5u);
+        BOOST_CHECK(slp->isLoaded());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(wav_parse_test)
+{
+    // Chunks of odd size are followed by a pad byte.
+    std::vector<char> odd = makeOddWav(5);
+    genie::WavData wav = wavOf(odd);
+
+    BOOST_REQUIRE(wav.parse());
+    BOOST_CHECK_EQUAL(wav.format, 1);
+    BOOST_CHECK_EQUAL(wav.channels, 1);
+    BOOST_CHECK_EQUAL(wav.sample_rate, 22050u);
+    BOOST_CHECK_EQUAL(wav.bits_per_sample, 8);
+    BOOST_REQUIRE_EQUAL(wav.samples_size, 5u);
+    BOOST_CHECK_EQUAL(wav.samples - wav.data.get(), odd.size() - 5);
+    BOOST_CHECK_EQUAL(wav.samples[4], 4);
+
+    // The data chunk claims more than the file holds.
+    std::vector<char> truncated = makeWav(100);
+    truncated.resize(truncated.size() - 60);
+    wav = wavOf(truncated);
+
+    BOOST_REQUIRE(wav.parse());
+    BOOST_CHECK_EQUAL(wav.samples_size, 40u);
+
+    // Ends inside the header of the data chunk.
+    truncated.resize(40);
+    BOOST_CHECK(!wavOf(truncated).parse());
+
+    // Ends inside the fmt chunk.
+    truncated.resize(24);
+    BOOST_CHECK(!wavOf(truncated).parse());
+
+    std::vector<char> other = makeSlp(4, 4);
+    BOOST_CHECK(!wavOf(other).parse());
+    BOOST_CHECK(!genie::WavData().parse());
+}
+
+BOOST_AUTO_TEST_CASE(get_wav_test)
+{
+    std::vector<char> odd = makeOddWav(7);
+    std::vector<char> truncated = makeWav(100);
+    truncated.resize(50);
+
+    genie::DrsWriter writer;
+    writer.setResource(genie::DrsWriter::WAV, 1, odd);
+    writer.setResource(genie::DrsWriter::WAV, 2, truncated);
+    writer.saveAs(DRS_PATH);
+
+    // Copied from the stream, or pointing into the mapped file.
+    for (bool concurrent : { false, true }) {
+        genie::DrsFile drs;
+        drs.setConcurrentAccess(concurrent);
+        drs.load(DRS_PATH);
+
+        genie::WavData wav = drs.getWav(1);
+
+        BOOST_REQUIRE_EQUAL(wav.size, odd.size());
+        BOOST_CHECK(std::memcmp(wav.data.get(), odd.data(), odd.size()) == 0);
+        BOOST_REQUIRE_EQUAL(wav.samples_size, 7u);
+        BOOST_CHECK_EQUAL(wav.samples[6], 6);
+
+        wav = drs.getWav(2);
+
+        BOOST_CHECK_EQUAL(wav.size, truncated.size());
+        BOOST_CHECK_EQUAL(wav.samples_size, 6u);
+
+        BOOST_CHECK(drs.getWav(3).empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_test)
+{
+    writeDrs();
+
+    std::vector<uint32_t> ids = { FIRST_SLP + 7, 1, FIRST_SLP + 2, FIRST_SLP };
+
+    // Without concurrent access everything is loaded before returning.
+    genie::DrsFile drs;
+    drs.load(DRS_PATH);
+
+    std::future<std::vector<genie::SlpFilePtr>> future = drs.prefetchSlpFiles(ids, true);
+    BOOST_CHECK(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+
+    std::vector<genie::SlpFilePtr> slps = future.get();
+    BOOST_REQUIRE_EQUAL(slps.size(), ids.size());
+    BOOST_CHECK(!slps[1]);
+    BOOST_CHECK(slps[0] == drs.getSlpFile(FIRST_SLP + 7));
+    BOOST_CHECK(slps[3] == drs.getSlpFile(FIRST_SLP));
+    BOOST_CHECK_EQUAL(slps[2]->getFrame(0)->getWidth(), 3u);
+
+    for (unsigned threads : { 1u, 4u }) {
+        genie::DrsFile concurrent;
+        concurrent.setConcurrentAccess(true);
+        concurrent.load(DRS_PATH);
+
+        slps = concurrent.prefetchSlpFiles(ids, true, threads).get();
+        BOOST_REQUIRE_EQUAL(slps.size(), ids.size());
+        BOOST_CHECK(!slps[1]);
+
+        for (size_t i : { 0, 2, 3 }) {
+            BOOST_REQUIRE(slps[i]);
+            BOOST_CHECK(slps[i]->isLoaded());
+            BOOST_CHECK(slps[i] == concurrent.getSlpFile(ids[i]));
+            BOOST_CHECK_EQUAL(slps[i]->getFrame(0)->getWidth(), ids[i] - FIRST_SLP + 1);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_error_test)
+{
+    genie::DrsWriter writer;
+    writer.setResource(genie::DrsWriter::SLP, 1, makeSlp(4, 4));
+    writer.setResource(genie::DrsWriter::SLP, 2, makeBadSlp());
+    writer.saveAs(DRS_PATH);
+
+    // Errors of any of the files are thrown by the future.
+    for (bool concurrent : { false, true }) {
+        genie::DrsFile drs;
+        drs.setConcurrentAccess(concurrent);
+        drs.load(DRS_PATH);
+
+        std::future<std::vector<genie::SlpFilePtr>> future = drs.prefetchSlpFiles({ 1, 2 }, true, 2);
+        BOOST_CHECK_THROW(future.get(), std::ios_base::failure);
+
+        // The good one was still loaded.
+        BOOST_CHECK_EQUAL(drs.getSlpFile(1)->getFrame(0)->getWidth(), 4u);
+        BOOST_CHECK_THROW(drs.getSlpFile(2), std::ios_base::failure);
+    }
+}
@@ -0,0 +1,125 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define BOOST_TEST_MODULE drs_writer_test
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "genie/resource/DrsFile.h"
+#include "genie/resource/DrsWriter.h"
+#include "genie/resource/SlpFile.h"
+
+#include "ResourceTestData.h"
+
+const char *const DRS_PATH = "drs_writer_test.drs";
+
+void checkSlp(genie::DrsFile &drs, uint32_t id, uint32_t width, uint32_t height)
+{
+    genie::SlpFilePtr slp = drs.getSlpFile(id);
+
+    BOOST_REQUIRE(slp);
+    BOOST_CHECK_EQUAL(slp->getFrame(0)->getWidth(), width);
+    BOOST_CHECK_EQUAL(slp->getFrame(0)->getHeight(), height);
+}
+
+void checkWav(genie::DrsFile &drs, uint32_t id, const std::vector<char> &wav)
+{
+    genie::WavData data = drs.getWav(id);
+
+    BOOST_REQUIRE_EQUAL(data.size, wav.size());
+    BOOST_CHECK(std::memcmp(data.data.get(), wav.data(), wav.size()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(save_test)
+{
+    std::vector<char> wav = makeWav(5000);
+
+    genie::DrsWriter writer;
+    writer.setResource(genie::DrsWriter::SLP, 100, makeSlp(10, 4));
+    writer.setResource(genie::DrsWriter::SLP, 101, makeSlp(20, 6));
+    writer.setResource(genie::DrsWriter::WAV, 100, wav);
+    writer.setAccessOrder({ { genie::DrsWriter::SLP, 101 }, { genie::DrsWriter::WAV, 100 } });
+    writer.saveAs(DRS_PATH);
+
+    // Ids are unique within a table only.
+    genie::DrsFile drs;
+    drs.load(DRS_PATH);
+
+    BOOST_CHECK_EQUAL(drs.slpFileIds().size(), 2u);
+    BOOST_CHECK_EQUAL(drs.wavFileIds().size(), 1u);
+    checkSlp(drs, 100, 10, 4);
+    checkSlp(drs, 101, 20, 6);
+    checkWav(drs, 100, wav);
+
+    genie::DrsWriter reader;
+    reader.load(DRS_PATH);
+
+    BOOST_CHECK_EQUAL(reader.resourceIds(genie::DrsWriter::SLP).size(), 2u);
+    BOOST_CHECK(reader.getResource(genie::DrsWriter::WAV, 100) == wav);
+    BOOST_CHECK(reader.getResource(genie::DrsWriter::SLP, 100) == makeSlp(10, 4));
+}
+
+BOOST_AUTO_TEST_CASE(append_test)
+{
+    std::vector<char> wav = makeWav(100);
+
+    genie::DrsWriter writer;
+    writer.setAlignment(1, 0);
+    writer.setResource(genie::DrsWriter::SLP, 1, makeSlp(8, 2));
+    writer.setResource(genie::DrsWriter::SLP, 2, makeSlp(9, 3));
+    writer.setResource(genie::DrsWriter::WAV, 1, wav);
+    writer.saveAs(DRS_PATH);
+
+    // Enough entries for the directory to grow over the old payloads.
+    genie::DrsWriter appended;
+    appended.setAlignment(1, 0);
+
+    for (uint32_t id = 10; id < 60; ++id)
+        appended.setResource(genie::DrsWriter::SLP, id, makeSlp(id, 2));
+
+    appended.setResource(genie::DrsWriter::SLP, 2, makeSlp(30, 5));
+    appended.append(DRS_PATH);
+
+    genie::DrsFile drs;
+    drs.load(DRS_PATH);
+
+    BOOST_CHECK_EQUAL(drs.slpFileIds().size(), 52u);
+    BOOST_CHECK_EQUAL(drs.wavFileIds().size(), 1u);
+    checkSlp(drs, 1, 8, 2);
+    checkSlp(drs, 2, 30, 5);
+    checkSlp(drs, 10, 10, 2);
+    checkSlp(drs, 59, 59, 2);
+    checkWav(drs, 1, wav);
+
+    // Appending to another table keeps a resource with the same id.
+    std::vector<char> other = makeWav(50);
+
+    genie::DrsWriter sounds;
+    sounds.setResource(genie::DrsWriter::WAV, 2, other);
+    sounds.append(DRS_PATH);
+
+    genie::DrsFile reloaded;
+    reloaded.load(DRS_PATH);
+
+    checkSlp(reloaded, 2, 30, 5);
+    checkWav(reloaded, 2, other);
+    checkWav(reloaded, 1, wav);
+}
@@ -0,0 +1,163 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define BOOST_TEST_MODULE resource_cache_test
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "genie/resource/DrsFile.h"
+#include "genie/resource/DrsWriter.h"
+#include "genie/resource/ResourceCache.h"
+
+#include "ResourceTestData.h"
+
+const char *const DRS_PATH = "resource_cache_test.drs";
+
+const uint32_t SLP_COUNT = 10;
+const uint32_t PAL_ID = 50;
+
+// Slp files 0 to SLP_COUNT - 1 of the same size and a palette.
+void writeDrs(void)
+{
+    genie::DrsWriter writer;
+
+    for (uint32_t id = 0; id < SLP_COUNT; ++id)
+        writer.setResource(genie::DrsWriter::SLP, id, makeSlp(10, 10));
+
+    writer.setResource(genie::DrsWriter::BINARY, PAL_ID, makePal(16));
+    writer.saveAs(DRS_PATH);
+}
+
+// Bytes the cache counts for one of the slp files.
+size_t slpBytes(void)
+{
+    auto cache = std::make_shared<genie::ResourceCache>(size_t(-1));
+
+    genie::DrsFile drs;
+    drs.setResourceCache(cache);
+    drs.load(DRS_PATH);
+    drs.getSlpFile(0);
+
+    return cache->getStats().bytes;
+}
+
+BOOST_AUTO_TEST_CASE(eviction_test)
+{
+    writeDrs();
+
+    size_t bytes = slpBytes();
+    BOOST_REQUIRE(bytes > 0);
+
+    // Room for three files.
+    auto cache = std::make_shared<genie::ResourceCache>(bytes * 3 + bytes / 2);
+
+    genie::DrsFile drs;
+    drs.setResourceCache(cache);
+    drs.load(DRS_PATH);
+
+    drs.getSlpFile(0);
+    drs.getSlpFile(1);
+    drs.getSlpFile(2);
+    drs.getSlpFile(0);
+
+    // The least recently used file is dropped.
+    drs.getSlpFile(3);
+
+    genie::ResourceCache::Stats stats = cache->getStats();
+    BOOST_CHECK_EQUAL(stats.entries, 3u);
+    BOOST_CHECK_EQUAL(stats.bytes, bytes * 3);
+    BOOST_CHECK_EQUAL(stats.evictions, 1u);
+    BOOST_CHECK_EQUAL(stats.hits, 1u);
+    BOOST_CHECK_EQUAL(stats.misses, 4u);
+
+    drs.getSlpFile(0);
+    drs.getSlpFile(1);
+
+    stats = cache->getStats();
+    BOOST_CHECK_EQUAL(stats.hits, 2u);
+    BOOST_CHECK_EQUAL(stats.misses, 5u);
+    BOOST_CHECK(stats.bytes <= cache->getBudget());
+
+    cache->setBudget(bytes);
+    BOOST_CHECK_EQUAL(cache->getStats().entries, 1u);
+
+    cache->clear();
+    BOOST_CHECK_EQUAL(cache->getStats().entries, 0u);
+    BOOST_CHECK_EQUAL(cache->getStats().bytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(pinning_test)
+{
+    writeDrs();
+
+    size_t bytes = slpBytes();
+    auto cache = std::make_shared<genie::ResourceCache>(bytes * 3 + bytes / 2);
+
+    genie::DrsFile drs;
+    drs.setResourceCache(cache);
+    drs.load(DRS_PATH);
+
+    // Files held outside of the cache stay over the budget.
+    std::vector<genie::SlpFilePtr> held;
+
+    for (uint32_t id = 0; id < SLP_COUNT; ++id)
+        held.push_back(drs.getSlpFile(id));
+
+    std::shared_ptr<genie::PalFile> pal = drs.getPalFilePtr(PAL_ID);
+
+    BOOST_CHECK_EQUAL(cache->getStats().entries, SLP_COUNT + 1);
+    BOOST_CHECK_EQUAL(cache->getStats().evictions, 0u);
+    BOOST_CHECK(drs.getSlpFile(0) == held[0]);
+    BOOST_CHECK(drs.getPalFilePtr(PAL_ID) == pal);
+
+    cache->clear();
+    BOOST_CHECK_EQUAL(cache->getStats().entries, SLP_COUNT + 1);
+
+    // Decoded frames are counted once the files are measured again.
+    held[0]->getFrame(0);
+    cache->trim();
+    BOOST_CHECK(cache->getStats().bytes > bytes * SLP_COUNT);
+
+    held.clear();
+    pal.reset();
+    cache->trim();
+
+    genie::ResourceCache::Stats stats = cache->getStats();
+    BOOST_CHECK(stats.bytes <= cache->getBudget());
+    BOOST_CHECK(stats.entries <= 3u);
+}
+
+BOOST_AUTO_TEST_CASE(shared_cache_test)
+{
+    writeDrs();
+
+    auto cache = std::make_shared<genie::ResourceCache>(size_t(-1));
+
+    genie::DrsFile first, second;
+    first.setResourceCache(cache);
+    first.load(DRS_PATH);
+    second.setResourceCache(cache);
+    second.load(DRS_PATH);
+
+    // The same ids of different files are different resources.
+    BOOST_CHECK(first.getSlpFile(1) != second.getSlpFile(1));
+    BOOST_CHECK(first.getSlpFile(1) == first.getSlpFile(1));
+    BOOST_CHECK_EQUAL(cache->getStats().entries, 2u);
+}
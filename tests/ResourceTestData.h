@@ -0,0 +1,107 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENIE_RESOURCETESTDATA_H
+#define GENIE_RESOURCETESTDATA_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+inline void put32(std::vector<char> &data, uint32_t value)
+{
+    data.insert(data.end(), reinterpret_cast<char *>(&value),
+                reinterpret_cast<char *>(&value) + 4);
+}
+
+inline void put16(std::vector<char> &data, uint16_t value)
+{
+    data.insert(data.end(), reinterpret_cast<char *>(&value),
+                reinterpret_cast<char *>(&value) + 2);
+}
+
+// Slp file with one frame of width (< 64) x height pixels, each row a single
+// block copy.
+inline std::vector<char> makeSlp(uint32_t width, uint32_t height)
+{
+    std::vector<char> data = { '2', '.', '0', 'N' };
+    put32(data, 1);
+    data.resize(data.size() + 24, 0);
+
+    uint32_t outlines = 32 + 32;
+    uint32_t commandTable = outlines + 4 * height;
+    uint32_t commands = commandTable + 4 * height;
+
+    put32(data, commandTable);
+    put32(data, outlines);
+    put32(data, 0);
+    put32(data, 0);
+    put32(data, width);
+    put32(data, height);
+    put32(data, 0);
+    put32(data, 0);
+
+    for (uint32_t row = 0; row < height; ++row)
+        put32(data, 0);
+
+    for (uint32_t row = 0; row < height; ++row)
+        put32(data, commands + row * (width + 2));
+
+    for (uint32_t row = 0; row < height; ++row) {
+        data.push_back(char(width << 2));
+        data.insert(data.end(), width, char(row + 1));
+        data.push_back(0x0f);
+    }
+
+    return data;
+}
+
+// 8 bit mono wav file with samples bytes of sound.
+inline std::vector<char> makeWav(uint32_t samples)
+{
+    std::vector<char> data = { 'R', 'I', 'F', 'F' };
+    put32(data, 36 + samples);
+    data.insert(data.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+    put32(data, 16);
+    put16(data, 1);
+    put16(data, 1);
+    put32(data, 22050);
+    put32(data, 22050);
+    put16(data, 1);
+    put16(data, 8);
+    data.insert(data.end(), { 'd', 'a', 't', 'a' });
+    put32(data, samples);
+
+    for (uint32_t i = 0; i < samples; ++i)
+        data.push_back(char(i));
+
+    return data;
+}
+
+// Palette file with count colors, color i is (i, i + 1, i + 2).
+inline std::vector<char> makePal(uint32_t count)
+{
+    std::string text = "JASC-PAL\r\n0100\r\n" + std::to_string(count) + "\r\n";
+
+    for (uint32_t i = 0; i < count; ++i)
+        text += std::to_string(i) + " " + std::to_string(i + 1) + " " + std::to_string(i + 2) + "\r\n";
+
+    return std::vector<char>(text.begin(), text.end());
+}
+
+#endif // GENIE_RESOURCETESTDATA_H
@@ -0,0 +1,154 @@
+/*
+    genieutils - <description>
+    Copyright (C) 2011  Armin Preiml <email>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define BOOST_TEST_MODULE unit_columns_test
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "genie/dat/UnitColumns.h"
+
+using genie::UnitColumns;
+using genie::UnitQuery;
+
+// Unit with hp hit points and an attack of amount against cls, if cls is set.
+genie::Unit makeUnit(int16_t hp, int16_t cls = -1, int16_t amount = 0)
+{
+    genie::Unit unit;
+    unit.Type = genie::Unit::CombatantType;
+    unit.HitPoints = hp;
+
+    if (cls != -1) {
+        genie::unit::AttackOrArmor attack;
+        attack.Class = cls;
+        attack.Amount = amount;
+        unit.Combat.Attacks.push_back(attack);
+    }
+
+    return unit;
+}
+
+// Civ 0 has units 0, 1 and 3, civ 1 has units 0 and 1.
+std::vector<genie::Civ> makeCivs(void)
+{
+    std::vector<genie::Civ> civs(2);
+
+    civs[0].Units = { makeUnit(10, 4, 5), makeUnit(20), makeUnit(0), makeUnit(40, 4, 7) };
+    civs[0].UnitPointers = { 1, 1, 0, 1 };
+    civs[1].Units = { makeUnit(15, 3, 2), makeUnit(25) };
+    civs[1].UnitPointers = { 1, 1 };
+
+    return civs;
+}
+
+BOOST_AUTO_TEST_CASE(columns_test)
+{
+    std::vector<genie::Civ> civs = makeCivs();
+    UnitColumns columns(civs);
+
+    BOOST_CHECK_EQUAL(columns.getCivCount(), 2u);
+    BOOST_CHECK_EQUAL(columns.getUnitCount(), 4u);
+    BOOST_REQUIRE_EQUAL(columns.getRowCount(), 8u);
+
+    size_t row = columns.row(1, 1);
+    BOOST_CHECK_EQUAL(columns.civOf(row), 1u);
+    BOOST_CHECK_EQUAL(columns.unitOf(row), 1u);
+    BOOST_CHECK_EQUAL(columns.column(UnitColumns::HIT_POINTS)[row], 25);
+
+    // Units without a pointer and rows behind the units of a civ.
+    BOOST_CHECK(!columns.exists(columns.row(0, 2)));
+    BOOST_CHECK(!columns.exists(columns.row(1, 3)));
+
+    float missing = columns.column(UnitColumns::HIT_POINTS)[columns.row(0, 2)];
+    BOOST_CHECK(missing != missing);
+
+    BOOST_CHECK_EQUAL(columns.attack(4)[columns.row(0, 3)], 7);
+    float noAttack = columns.attack(4)[columns.row(0, 1)];
+    BOOST_CHECK(noAttack != noAttack);
+
+    float noClass = columns.attack(20)[0];
+    BOOST_CHECK(noClass != noClass);
+}
+
+BOOST_AUTO_TEST_CASE(query_test)
+{
+    std::vector<genie::Civ> civs = makeCivs();
+    UnitColumns columns(civs);
+
+    BOOST_CHECK_EQUAL(UnitQuery(columns).count(), 5u);
+
+    UnitQuery strong(columns);
+    strong.where(UnitColumns::HIT_POINTS, UnitQuery::GREATER_EQUAL, 20);
+
+    BOOST_CHECK(strong.select(columns.column(UnitColumns::HIT_POINTS))
+                == std::vector<float>({ 20, 40, 25 }));
+
+    UnitQuery civ1(columns);
+    civ1.civ(1).where(UnitColumns::HIT_POINTS, UnitQuery::LESS, 20);
+
+    BOOST_REQUIRE_EQUAL(civ1.count(), 1u);
+    BOOST_CHECK_EQUAL(civ1.rows()[0], columns.row(1, 0));
+
+    UnitQuery::Summary hp = UnitQuery(columns).summarize(UnitColumns::HIT_POINTS);
+
+    BOOST_CHECK_EQUAL(hp.count, 5u);
+    BOOST_CHECK_EQUAL(hp.sum, 110);
+    BOOST_CHECK_EQUAL(hp.min, 10);
+    BOOST_CHECK_EQUAL(hp.max, 40);
+    BOOST_CHECK_EQUAL(hp.mean, 22);
+
+    // Units without the attack are left out.
+    UnitQuery::Summary attack = UnitQuery(columns).summarize(columns.attack(4));
+
+    BOOST_CHECK_EQUAL(attack.count, 2u);
+    BOOST_CHECK_EQUAL(attack.mean, 6);
+
+    UnitQuery other(columns);
+    other.where(columns.attack(4), UnitQuery::NOT_EQUAL, 5);
+
+    BOOST_REQUIRE_EQUAL(other.count(), 1u);
+    BOOST_CHECK_EQUAL(other.rows()[0], columns.row(0, 3));
+
+    UnitQuery none(columns);
+    none.where(UnitColumns::HIT_POINTS, UnitQuery::EQUAL, 1000);
+
+    BOOST_CHECK_EQUAL(none.summarize(UnitColumns::HIT_POINTS).count, 0u);
+    BOOST_CHECK_EQUAL(none.summarize(UnitColumns::HIT_POINTS).mean, 0);
+}
+
+BOOST_AUTO_TEST_CASE(update_test)
+{
+    std::vector<genie::Civ> civs = makeCivs();
+    UnitColumns columns(civs);
+
+    civs[0].editUnit(1) = makeUnit(50, 4, 9);
+    columns.update(0, 1);
+
+    BOOST_CHECK_EQUAL(columns.column(UnitColumns::HIT_POINTS)[columns.row(0, 1)], 50);
+    BOOST_CHECK_EQUAL(columns.attack(4)[columns.row(0, 1)], 9);
+
+    // More units than rows, all are copied again.
+    civs[1].Units.resize(6, makeUnit(60));
+    civs[1].UnitPointers.resize(6, 1);
+    columns.updateCiv(1);
+
+    BOOST_CHECK_EQUAL(columns.getUnitCount(), 6u);
+    BOOST_CHECK_EQUAL(columns.column(UnitColumns::HIT_POINTS)[columns.row(1, 5)], 60);
+    BOOST_CHECK_EQUAL(columns.column(UnitColumns::HIT_POINTS)[columns.row(0, 1)], 50);
+    BOOST_CHECK_EQUAL(UnitQuery(columns).civ(1).count(), 6u);
+}